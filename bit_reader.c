@@ -5,58 +5,207 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include "bit_reader.h"
 
-struct bit_reader {
-	FILE *file;
-	uint8_t buffer;
-	uint8_t bit_pos;
-};
-
 struct bit_reader *bit_reader_create(FILE *in)
 {
 	struct bit_reader *reader = calloc(1, sizeof(*reader));
+	if (reader == NULL)
+		return NULL;
+
+	reader->buffer = malloc(BIT_READER_BUF_SIZE);
+	if (reader->buffer == NULL) {
+		free(reader);
+		return NULL;
+	}
+
 	reader->file = in;
+	reader->pos = reader->buffer;
+	reader->end = reader->buffer;
 	return reader;
 }
 
 void bit_reader_destroy(struct bit_reader *reader)
 {
+	free(reader->buffer);
 	free(reader);
 }
 
-bool bit_reader_next_bit(struct bit_reader *reader, uint8_t *bit)
+/* reader for data already in memory, doesn't need bit_reader_destroy */
+void bit_reader_init_mem(struct bit_reader *reader, const uint8_t data[],
+						 size_t size)
 {
 	assert(reader != NULL);
-	assert(bit    != NULL);
+	assert(data != NULL || size == 0);
+
+	reader->file = NULL;
+	reader->buffer = NULL;
+	reader->pos = data;
+	reader->end = data + size;
+	reader->iov = NULL;
+	reader->iovcnt = 0;
+	reader->iov_skip = 0;
+	reader->in_seam = false;
+	reader->bits = 0;
+	reader->num_bits = 0;
+	reader->marker = 0;
+	reader->eof = false;
+	reader->pad_bits = 0;
+}
 
-	if (reader->bit_pos == 0) {
-		/* read next byte */
-		uint8_t data;
-		if (fread(&data, sizeof(data), 1, reader->file) != sizeof(data))
+/* reader for data in segments, which aren't copied together; doesn't need
+ * bit_reader_destroy */
+void bit_reader_init_iov(struct bit_reader *reader, const struct iovec iov[],
+						 int iovcnt)
+{
+	assert(iov != NULL || iovcnt == 0);
+
+	bit_reader_init_mem(reader, NULL, 0);
+	reader->iov = iov;
+	reader->iovcnt = iovcnt;
+}
+
+/* Continues with the next segment, returns the number of bytes that can be
+ * read from pos. The unread bytes of the current segment and the start of
+ * the next ones go to the seam. Once the unread bytes of the seam are all
+ * from the next segment, reading continues in the segment itself. */
+static size_t next_segment(struct bit_reader *reader)
+{
+	size_t rem = reader->end - reader->pos;
+
+	if (reader->in_seam && reader->iovcnt > 0 && rem <= reader->iov_skip) {
+		const uint8_t *base = reader->iov->iov_base;
+		reader->pos = base + reader->iov_skip - rem;
+		reader->end = base + reader->iov->iov_len;
+		reader->iov++;
+		reader->iovcnt--;
+		reader->iov_skip = 0;
+		reader->in_seam = false;
+
+		rem = reader->end - reader->pos;
+		if (rem >= BIT_READER_SLACK)
+			return rem;
+	}
+
+	assert(rem < BIT_READER_SLACK);
+	if (rem > 0)
+		memmove(reader->seam, reader->pos, rem);
+
+	while (rem < sizeof(reader->seam) && reader->iovcnt > 0) {
+		const uint8_t *base = reader->iov->iov_base;
+		size_t avail = reader->iov->iov_len - reader->iov_skip;
+		size_t len = sizeof(reader->seam) - rem;
+		if (len > avail)
+			len = avail;
+
+		memcpy(&reader->seam[rem], base + reader->iov_skip, len);
+		rem += len;
+		reader->iov_skip += len;
+
+		if (reader->iov_skip == reader->iov->iov_len) {
+			reader->iov++;
+			reader->iovcnt--;
+			reader->iov_skip = 0;
+		}
+	}
+
+	reader->pos = reader->seam;
+	reader->end = reader->seam + rem;
+	reader->in_seam = true;
+	return rem;
+}
+
+static bool next_byte(struct bit_reader *reader, uint8_t *byte)
+{
+	if (reader->pos == reader->end) {
+		if (reader->iov != NULL)
+			return next_segment(reader) > 0 && next_byte(reader, byte);
+
+		if (reader->file == NULL)
 			return false;
 
-		if (data == 0xFF) {
-			/* possible marker - check next byte */
-			if (fread(&data, sizeof(data), 1, reader->file) != sizeof(data))
-				return false;
+		size_t len = fread(reader->buffer, 1, BIT_READER_BUF_SIZE, reader->file);
+		if (len == 0)
+			return false;
+
+		reader->pos = reader->buffer;
+		reader->end = reader->buffer + len;
+	}
+
+	*byte = *reader->pos;
+	reader->pos++;
+	return true;
+}
 
-			if (data != 0)
-				return false;
+/* moves the unread bytes to the start of the buffer and reads more data from
+ * the file (or continues in the next segment) so that the fast refill can
+ * continue */
+bool bit_reader_more(struct bit_reader *reader)
+{
+	assert(reader != NULL);
+
+	if (reader->eof)
+		return false;
+
+	if (reader->iov != NULL)
+		return next_segment(reader) >= BIT_READER_SLACK;
 
-			data = 0xFF;
+	if (reader->file == NULL)
+		return false;
+
+	size_t rem = reader->end - reader->pos;
+	memmove(reader->buffer, reader->pos, rem);
+
+	size_t len = fread(reader->buffer + rem, 1, BIT_READER_BUF_SIZE - rem,
+					   reader->file);
+
+	reader->pos = reader->buffer;
+	reader->end = reader->buffer + rem + len;
+	return rem + len >= BIT_READER_SLACK;
+}
+
+void bit_reader_fill(struct bit_reader *reader)
+{
+	assert(reader != NULL);
+
+	while (reader->num_bits <= 56) {
+		uint8_t data;
+
+		if (reader->eof || !next_byte(reader, &data)) {
+			/* no more data - append zero bits */
+			reader->eof = true;
+			reader->num_bits += 8;
+			reader->pad_bits += 8;
+			continue;
 		}
 
-		*bit = (data & 0x80) >> 7;
-		reader->buffer = data << 1;
-		reader->bit_pos = 7;
-		return true;
+		if (data == 0xFF) {
+			/* possible marker - check next byte */
+			uint8_t next = 0;
+			if (!next_byte(reader, &next) || next != 0) {
+				reader->marker = next;
+				reader->eof = true;
+				continue;
+			}
+		}
+
+		reader->bits |= (uint64_t)data << (56 - reader->num_bits);
+		reader->num_bits += 8;
 	}
+}
 
-	*bit = (reader->buffer & 0x80) >> 7;
-	reader->buffer <<= 1;
-	reader->bit_pos--;
+bool bit_reader_next_bit(struct bit_reader *reader, uint8_t *bit)
+{
+	assert(reader != NULL);
+	assert(bit    != NULL);
+
+	uint16_t tmp;
+	if (!bit_reader_next_bits(reader, &tmp, 1))
+		return false;
+
+	*bit = tmp;
 	return true;
 }
 
@@ -66,17 +215,19 @@ bool bit_reader_next_bits(struct bit_reader *reader, uint16_t *bits, uint8_t num
 	assert(bits   != NULL);
 	assert(num <= 16);
 
-	uint16_t tmp = 0;
+	if (num == 0) {
+		*bits = 0;
+		return true;
+	}
 
-	for (int i = 0; i < num; i++) {
-		uint8_t bit;
-		if (!bit_reader_next_bit(reader, &bit))
-			return false;
+	bit_reader_refill(reader);
 
-		tmp = (tmp << 1) | (bit & 0x01);
-	}
+	/* padding bits are always at the end of the bit buffer */
+	if (reader->pad_bits + num > reader->num_bits)
+		return false;
 
-	*bits = tmp;
+	*bits = bit_reader_peek(reader, num);
+	bit_reader_consume(reader, num);
 	return true;
 }
 
@@ -11,13 +11,109 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <sys/uio.h>
 
-struct bit_reader;
+#define BIT_READER_BUF_SIZE (64 * 1024)
+#define BIT_READER_SLACK    (8)
+
+/* The bit buffer is kept MSB aligned. After a refill at least 56 bits are
+ * available. At the end of the data (end of file or marker) zero bits are
+ * appended and counted in pad_bits. The fields are public so that the decode
+ * kernels can inline the refill. */
+struct bit_reader {
+	FILE *file;
+	const uint8_t *pos;
+	const uint8_t *end;
+	uint8_t *buffer;
+
+	/* Segments (iovec) that aren't read yet. The few bytes around the border
+	 * of two segments are copied to seam, so the fast refill can load 8
+	 * bytes at once. iov_skip bytes of the next segment are in seam. */
+	const struct iovec *iov;
+	int iovcnt;
+	size_t iov_skip;
+	bool in_seam;
+	uint8_t seam[2 * BIT_READER_SLACK];
+
+	uint64_t bits;
+	uint8_t  num_bits;
+	uint8_t  marker; /* second byte of the marker that ended the data */
+	bool     eof;
+	size_t   pad_bits;
+};
 
 struct bit_reader *bit_reader_create(FILE *in);
 void bit_reader_destroy(struct bit_reader *reader);
+void bit_reader_init_mem(struct bit_reader *reader, const uint8_t data[],
+						 size_t size);
+void bit_reader_init_iov(struct bit_reader *reader, const struct iovec iov[],
+						 int iovcnt);
+void bit_reader_fill(struct bit_reader *reader);
+bool bit_reader_more(struct bit_reader *reader);
 bool bit_reader_next_bit(struct bit_reader *reader, uint8_t *bit);
 bool bit_reader_next_bits(struct bit_reader *reader, uint16_t *bits, uint8_t num);
 
+static inline void bit_reader_refill(struct bit_reader *reader)
+{
+	/* fast path: plain bytes from the buffer, no marker or stuffing */
+	while (reader->num_bits <= 56 && reader->pos < reader->end &&
+		   *reader->pos != 0xFF) {
+		reader->bits |= (uint64_t)*reader->pos << (56 - reader->num_bits);
+		reader->num_bits += 8;
+		reader->pos++;
+	}
+
+	if (reader->num_bits <= 56)
+		bit_reader_fill(reader);
+}
+
+/* true if at least BIT_READER_SLACK bytes can be read without checks */
+static inline bool bit_reader_has_slack(struct bit_reader *reader)
+{
+	return reader->end - reader->pos >= BIT_READER_SLACK ||
+		bit_reader_more(reader);
+}
+
+/* Refill without bounds checks, only valid if bit_reader_has_slack is true.
+ * Loads 8 bytes at once and falls back to the byte wise refill if one of
+ * them is 0xFF (stuffing or marker). */
+static inline void bit_reader_refill_fast(struct bit_reader *reader)
+{
+	const uint8_t *p = reader->pos;
+	uint64_t word = (uint64_t)p[0] << 56 | (uint64_t)p[1] << 48 |
+		(uint64_t)p[2] << 40 | (uint64_t)p[3] << 32 |
+		(uint64_t)p[4] << 24 | (uint64_t)p[5] << 16 |
+		(uint64_t)p[6] <<  8 | (uint64_t)p[7];
+
+	/* zero byte in ~word <=> 0xFF byte in word */
+	uint64_t inv = ~word;
+	if (((inv - 0x0101010101010101) & word & 0x8080808080808080) != 0) {
+		bit_reader_refill(reader);
+		return;
+	}
+
+	reader->bits |= word >> reader->num_bits;
+	reader->pos += (63 - reader->num_bits) >> 3;
+	reader->num_bits |= 56;
+}
+
+/* true if zero bits appended after the end of the data were consumed */
+static inline bool bit_reader_overrun(const struct bit_reader *reader)
+{
+	return reader->pad_bits > reader->num_bits;
+}
+
+static inline uint16_t bit_reader_peek(const struct bit_reader *reader,
+									   uint8_t num)
+{
+	return reader->bits >> (64 - num);
+}
+
+static inline void bit_reader_consume(struct bit_reader *reader, uint8_t num)
+{
+	reader->bits <<= num;
+	reader->num_bits -= num;
+}
+
 #endif
 
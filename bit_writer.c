@@ -5,72 +5,230 @@
  */
 
 #include <stdlib.h>
+#include <assert.h>
 #include "bit_writer.h"
 
-struct bit_writer {
-	FILE *file;
-	uint8_t buffer;
-	uint8_t bit_pos;
-};
-
 struct bit_writer *bit_writer_create(FILE *out)
 {
 	struct bit_writer *writer = calloc(1, sizeof(*writer));
+	if (writer == NULL)
+		return NULL;
+
+	writer->buffer = malloc(BIT_WRITER_BUF_SIZE);
+	if (writer->buffer == NULL) {
+		free(writer);
+		return NULL;
+	}
+
 	writer->file = out;
+	writer->pos = writer->buffer;
+	writer->end = writer->buffer + BIT_WRITER_BUF_SIZE;
 	return writer;
 }
 
+static bool write_buffer(struct bit_writer *writer)
+{
+	size_t len = writer->pos - writer->buffer;
+	writer->pos = writer->buffer;
+	writer->num_written += len;
+
+	return fwrite(writer->buffer, 1, len, writer->file) == len;
+}
+
 void bit_writer_destroy(struct bit_writer *writer)
 {
 	/* write out remaining bits */
-	if (writer->bit_pos > 0) {
-		/* append '1' */
-		while(writer->bit_pos != 0)
-			bit_writer_next_bit(writer, 1);
-	}
+	bit_writer_align(writer);
+	write_buffer(writer);
 
+	free(writer->buffer);
 	free(writer);
 }
 
-bool bit_writer_next_bit(struct bit_writer *writer, uint8_t bit)
+void bit_writer_init_mem(struct bit_writer *writer, uint8_t buffer[],
+						 size_t size)
 {
-	uint8_t buffer = writer->buffer;
-	uint8_t bit_pos = writer->bit_pos;
+	assert(writer != NULL);
+	assert(buffer != NULL || size == 0);
 
-	buffer |= (bit & 0x01) << (7 - bit_pos);
-	bit_pos++;
+	writer->file = NULL;
+	writer->buffer = buffer;
+	writer->pos = buffer;
+	writer->end = buffer + size;
+	writer->iov = NULL;
+	writer->iovcnt = 0;
+	writer->iov_filled = 0;
+	writer->bits = 0;
+	writer->num_bits = 0;
+	writer->num_stuffed = 0;
+	writer->num_written = 0;
+	writer->raw = false;
+}
 
-	if (bit_pos == 8) {
-		if (fwrite(&buffer, sizeof(buffer), 1, writer->file) != 1)
-			return false;
+/* memory writer without byte stuffing, for streams with a known length */
+void bit_writer_init_raw(struct bit_writer *writer, uint8_t buffer[],
+						 size_t size)
+{
+	bit_writer_init_mem(writer, buffer, size);
+	writer->raw = true;
+}
+
+/* writer for caller provided segments, doesn't need bit_writer_destroy */
+void bit_writer_init_iov(struct bit_writer *writer, const struct iovec iov[],
+						 int iovcnt)
+{
+	bit_writer_init_mem(writer, NULL, 0);
+	bit_writer_set_iov(writer, iov, iovcnt);
+}
+
+/* Continues in new segments, e.g. after the filled ones were sent. Pending
+ * bits are kept. */
+void bit_writer_set_iov(struct bit_writer *writer, const struct iovec iov[],
+						int iovcnt)
+{
+	assert(writer != NULL);
+	assert(iov != NULL || iovcnt == 0);
+
+	writer->num_written += writer->iov_filled + bit_writer_size(writer);
+	writer->buffer = NULL;
+	writer->pos = NULL;
+	writer->end = NULL;
+	writer->iov = iov;
+	writer->iovcnt = iovcnt;
+	writer->iov_filled = 0;
+}
+
+/* bytes written to the segments of bit_writer_set_iov */
+size_t bit_writer_iov_size(const struct bit_writer *writer)
+{
+	return writer->iov_filled + bit_writer_size(writer);
+}
+
+size_t bit_writer_size(const struct bit_writer *writer)
+{
+	return writer->pos - writer->buffer;
+}
+
+/* Position of the next bit in the output, stuffed bytes included. Only valid
+ * after bit_writer_flush_bits, when less than 8 bits are pending. */
+uint64_t bit_writer_tell(const struct bit_writer *writer)
+{
+	assert(writer->num_bits < 8);
+
+	return 8 * (writer->num_written + writer->iov_filled +
+				bit_writer_size(writer)) + writer->num_bits;
+}
+
+/* moves on to the next segment with space */
+static bool next_segment(struct bit_writer *writer)
+{
+	while (writer->iovcnt > 0) {
+		writer->iov_filled += bit_writer_size(writer);
+		writer->buffer = writer->iov->iov_base;
+		writer->pos = writer->buffer;
+		writer->end = writer->buffer + writer->iov->iov_len;
+		writer->iov++;
+		writer->iovcnt--;
+
+		if (writer->pos != writer->end)
+			return true;
+	}
 
-		if (buffer == 0xFF) {
-			buffer = 0;
-			if (fwrite(&buffer, sizeof(buffer), 1, writer->file) != 1)
+	return false;
+}
+
+static inline bool put_byte(struct bit_writer *writer, uint8_t byte)
+{
+	if (writer->pos == writer->end) {
+		if (writer->file != NULL) {
+			if (!write_buffer(writer))
 				return false;
+		} else if (!next_segment(writer)) {
+			return false;
 		}
-		bit_pos = 0;
-		buffer = 0;
 	}
 
-	writer->buffer = buffer;
-	writer->bit_pos = bit_pos;
+	*writer->pos = byte;
+	writer->pos++;
 	return true;
 }
 
-bool bit_writer_next_bits(struct bit_writer *writer, uint16_t bits, uint8_t num)
+/* true if size bytes fit into the current and the remaining segments */
+static bool has_room(const struct bit_writer *writer, size_t size)
 {
-	/* Msb first */
-	for (int i = 0; i < num; i++) {
-		uint8_t bit = (bits >> (num - i - 1));
-		if (!bit_writer_next_bit(writer, bit))
+	if (writer->file != NULL)
+		return true;
+
+	size_t room = writer->end - writer->pos;
+	for (int i = 0; i < writer->iovcnt && room < size; i++)
+		room += writer->iov[i].iov_len;
+
+	return room >= size;
+}
+
+/* On a full output the bytes that didn't fit stay pending, so the writer can
+ * continue after bit_writer_set_iov. */
+bool bit_writer_flush_bits(struct bit_writer *writer)
+{
+	while (writer->num_bits >= 8) {
+		uint8_t byte = writer->bits >> (writer->num_bits - 8);
+
+		/* 0xFF is followed by a zero byte so it can't be read as marker,
+		 * both are written or none */
+		if (byte == 0xFF && !writer->raw) {
+			if (!has_room(writer, 2) || !put_byte(writer, byte) ||
+				!put_byte(writer, 0))
+				return false;
+
+			writer->num_stuffed++;
+		} else if (!put_byte(writer, byte)) {
 			return false;
+		}
 
+		writer->num_bits -= 8;
 	}
 
 	return true;
 }
 
+/* bytes without stuffing, e.g. a marker, only after bit_writer_align */
+bool bit_writer_write_raw(struct bit_writer *writer, const uint8_t data[],
+						  size_t len)
+{
+	assert(writer->num_bits == 0);
+
+	for (size_t i = 0; i < len; i++) {
+		if (!put_byte(writer, data[i]))
+			return false;
+	}
+
+	return true;
+}
+
+/* passes the buffered bytes on to the file */
+bool bit_writer_sync(struct bit_writer *writer)
+{
+	if (writer->file == NULL)
+		return true;
+
+	return write_buffer(writer) && fflush(writer->file) == 0;
+}
+
+bool bit_writer_align(struct bit_writer *writer)
+{
+	/* append '1' */
+	uint8_t pad = (8 - (writer->num_bits & 7)) & 7;
+	writer->bits = (writer->bits << pad) | ((1u << pad) - 1);
+	writer->num_bits += pad;
+
+	return bit_writer_flush_bits(writer);
+}
+
+bool bit_writer_next_bit(struct bit_writer *writer, uint8_t bit)
+{
+	return bit_writer_next_bits(writer, bit, 1);
+}
+
 #if 0
 
 int main(void)
@@ -11,14 +11,66 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
 
-struct bit_writer;
+#define BIT_WRITER_BUF_SIZE (64 * 1024)
+
+/* Bits are collected LSB aligned and written out as whole bytes once 32 bits
+ * are pending. The output is either a file (through an internal buffer), a
+ * caller provided memory buffer or caller provided segments (iovec), which
+ * are filled one after the other. */
+struct bit_writer {
+	FILE *file;
+	uint8_t *buffer;
+	uint8_t *pos;
+	uint8_t *end;
+
+	/* segments after the current one */
+	const struct iovec *iov;
+	int iovcnt;
+	size_t iov_filled; /* bytes in the segments before the current one */
+
+	uint64_t bits;
+	uint8_t  num_bits;
+	uint64_t num_stuffed; /* zero bytes inserted after 0xFF */
+	uint64_t num_written; /* bytes written to the file */
+	bool     raw;         /* no byte stuffing */
+};
 
 struct bit_writer *bit_writer_create(FILE *out);
 void bit_writer_destroy(struct bit_writer *writer);
+void bit_writer_init_mem(struct bit_writer *writer, uint8_t buffer[],
+						 size_t size);
+void bit_writer_init_raw(struct bit_writer *writer, uint8_t buffer[],
+						 size_t size);
+void bit_writer_init_iov(struct bit_writer *writer, const struct iovec iov[],
+						 int iovcnt);
+void bit_writer_set_iov(struct bit_writer *writer, const struct iovec iov[],
+						int iovcnt);
+size_t bit_writer_iov_size(const struct bit_writer *writer);
+size_t bit_writer_size(const struct bit_writer *writer);
+uint64_t bit_writer_tell(const struct bit_writer *writer);
 
+bool bit_writer_flush_bits(struct bit_writer *writer);
+bool bit_writer_write_raw(struct bit_writer *writer, const uint8_t data[],
+						  size_t len);
+bool bit_writer_sync(struct bit_writer *writer);
+bool bit_writer_align(struct bit_writer *writer);
 bool bit_writer_next_bit(struct bit_writer *writer, uint8_t bit);
-bool bit_writer_next_bits(struct bit_writer *writer, uint16_t bits, uint8_t num);
+
+static inline bool bit_writer_next_bits(struct bit_writer *writer,
+										uint16_t bits, uint8_t num)
+{
+	/* Msb first */
+	writer->bits = (writer->bits << num) | (bits & ((1u << num) - 1));
+	writer->num_bits += num;
+
+	if (writer->num_bits >= 32)
+		return bit_writer_flush_bits(writer);
+
+	return true;
+}
 
 #endif
 
@@ -4,6 +4,15 @@
  * @author Fabjan Sukalia <fsukalia@gmail.com>
  * @brief Tool to decode huffman encoded data in JPEG format
  */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,70 +20,865 @@
 #include <stdint.h>
 #include "bit_reader.h"
 #include "huff_dec.h"
+#include "huff_table.h"
+#include "huff_lanes.h"
+#include "huff_seek.h"
+#include "huff_cache.h"
+#include "huff_pool.h"
+#include "huff_wide.h"
+#include "huff_search.h"
+#include "huff_format.h"
+
+#define DECODE_WIDE_CHUNK (16 * 1024)
 
-#define JPG_DHT		(0xC4)
+/* a plain stream is written in segments with writev */
+#define IOV_SEGMENTS (16)
+#define IOV_SEGMENT_SIZE (16 * 1024)
 
 static const char *prog_name = "hufdec";
 
+static enum {
+	STATS_NONE,
+	STATS_TEXT,
+	STATS_JSON
+} stats_format = STATS_NONE;
+
+static enum huff_dec_mode dec_mode = HUFF_DEC_TABLE;
+
+/* --range: decode only range_len symbols starting at range_offset */
+static bool range_mode = false;
+static uint64_t range_offset;
+static size_t range_len;
+
+/* 1 if --search found nothing or --verify found a damaged block */
+static int exit_status = 0;
+
+/* --force: -m and -x replace existing output files */
+static bool force = false;
+
 void usage(void)
 {
-	fprintf(stderr, "USAGE: %s FILE_IN [FILE_OUT]\n", prog_name);
+	fprintf(stderr, "USAGE: %s [--stats|--stats-json] [--canonical] "
+			"[-t DICT]... [--range OFFSET LEN] FILE_IN [FILE_OUT]\n", prog_name);
+	fprintf(stderr, "       %s [--stats|--stats-json] [--canonical] "
+			"[-t DICT]... [--range OFFSET LEN] --batch FILE_IN FILE_OUT...\n",
+			prog_name);
+	fprintf(stderr, "       %s [--stats|--stats-json] [--canonical] "
+			"[-t DICT]... [-j THREADS] [--force] -m FILE.huf...\n", prog_name);
+	fprintf(stderr, "       %s [--stats|--stats-json] [--canonical] "
+			"[-t DICT]... [-j THREADS] [--force] -x ARCHIVE DIR\n", prog_name);
+	fprintf(stderr, "       %s [--stats|--stats-json] [--canonical] "
+			"[-t DICT]... --search PATTERN FILE_IN\n", prog_name);
+	fprintf(stderr, "       %s [--stats|--stats-json] [--canonical] "
+			"[-j THREADS] --verify FILE_IN...\n", prog_name);
 	exit(EXIT_FAILURE);
 }
 
 
-void decode(FILE *in, FILE *out)
+/* returns false if the header has no symbols */
+/* symbols returns the symbols of the table, at most 256 */
+static bool read_dht_symbols(FILE *in, struct huff_dec *dec, uint8_t symbols[],
+							 uint16_t *num_symbols)
 {
-	uint8_t header[21];
+	uint8_t header[19];
 	if (fread(header, sizeof(header), 1, in) != 1) {
 		fprintf(stderr, "Couldn't read header\n");
 		exit(EXIT_FAILURE);
 	}
 
-	if (header[0] != 0xFF || header[1] != JPG_DHT) {
-		fprintf(stderr, "Invalid header\n");
-		exit(EXIT_FAILURE);
-	}
-
-	uint16_t header_length = (header[2] << 8) | header[3];
+	uint16_t header_length = (header[0] << 8) | header[1];
 	if (header_length < 19 || header_length > (19 + 256)) {
 		fprintf(stderr, "Invalid header length\n");
 		exit(EXIT_FAILURE);
 	}
 
 	/* table class and destination index - must be zero */
-	if (header[4] != 0) {
+	if (header[2] != 0) {
 		fprintf(stderr, "Invalid table class and destination index\n");
 		exit(EXIT_FAILURE);
 	}
 
 	uint16_t sum_symbol = 0;
 	for (int i = 0; i < 16; i++)
-		sum_symbol += header[5 + i];
+		sum_symbol += header[3 + i];
 
+	*num_symbols = 0;
 	if (sum_symbol == 0 || header_length == 19)
-		return; /* nothing to do */
+		return false; /* nothing to do */
+
+	if (sum_symbol > 256) {
+		fprintf(stderr, "Invalid symbol table\n");
+		exit(EXIT_FAILURE);
+	}
 
-	uint8_t symbols[sum_symbol];
-	if (fread(symbols, sizeof(symbols), 1, in) != 1) {
+	if (fread(symbols, sum_symbol, 1, in) != 1) {
 		fprintf(stderr, "Couldn't read symbol table\n");
 		exit(EXIT_FAILURE);
 	}
 
-	/* how many bytes for the output or how many symbols to read */
+	if (!huff_cache_get_dec(&header[3], symbols, dec)) {
+		fprintf(stderr, "Couldn't create decoder\n");
+		exit(EXIT_FAILURE);
+	}
+
+	*num_symbols = sum_symbol;
+	return true;
+}
+
+static bool read_dht(FILE *in, struct huff_dec *dec)
+{
+	uint8_t symbols[256];
+	uint16_t num_symbols;
+	return read_dht_symbols(in, dec, symbols, &num_symbols);
+}
+
+static const struct huff_table *read_dtr(FILE *in, struct huff_dec *dec)
+{
+	uint8_t header[3];
+	if (fread(header, sizeof(header), 1, in) != 1) {
+		fprintf(stderr, "Couldn't read header\n");
+		exit(EXIT_FAILURE);
+	}
+
+	uint16_t header_length = (header[0] << 8) | header[1];
+	if (header_length != 3) {
+		fprintf(stderr, "Invalid header length\n");
+		exit(EXIT_FAILURE);
+	}
+
+	const struct huff_table *table = huff_table_find(header[2]);
+	if (table == NULL) {
+		fprintf(stderr, "Unknown table id %u\n", (unsigned)header[2]);
+		exit(EXIT_FAILURE);
+	}
+
+	huff_dec_from_table(table, dec);
+	return table;
+}
+
+/* Files written before the 64 bit count store the number of symbols as plain
+ * 4 byte big endian value. A DNL segment can only be confused with an old
+ * count of exactly 0xFFDC000A. */
+static uint64_t read_num_sym(FILE *in)
+{
 	uint8_t tmp[4];
-	if (fread(tmp, 4, 1, in) != 1) {
+	if (fread(tmp, sizeof(tmp), 1, in) != 1) {
+		fprintf(stderr, "Couldn't read number of data\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (tmp[0] != 0xFF || tmp[1] != JPG_DNL || tmp[2] != 0 || tmp[3] != 10)
+		return ((uint64_t)tmp[0] << 24) | (tmp[1] << 16) | (tmp[2] << 8) | tmp[3];
+
+	uint8_t count[8];
+	if (fread(count, sizeof(count), 1, in) != 1) {
 		fprintf(stderr, "Couldn't read number of data\n");
 		exit(EXIT_FAILURE);
 	}
 
-	uint32_t num_sym = (tmp[0] << 24) | (tmp[1] << 16) | (tmp[2] << 8) | tmp[3];
+	uint64_t num_sym = 0;
+	for (int i = 0; i < 8; i++)
+		num_sym = (num_sym << 8) | count[i];
+
+	if (num_sym > SIZE_MAX) {
+		fprintf(stderr, "Invalid number of data\n");
+		exit(EXIT_FAILURE);
+	}
+
+	return num_sym;
+}
+
+/* returns the number of lanes */
+static uint8_t read_ilv(FILE *in, size_t lane_size[])
+{
+	uint8_t header[3];
+	if (fread(header, sizeof(header), 1, in) != 1) {
+		fprintf(stderr, "Couldn't read header\n");
+		exit(EXIT_FAILURE);
+	}
+
+	uint16_t header_length = (header[0] << 8) | header[1];
+	uint8_t num_lanes = header[2];
+	if (num_lanes == 0 || num_lanes > HUFF_MAX_LANES ||
+		header_length != 3 + 8 * num_lanes) {
+		fprintf(stderr, "Invalid lane header\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (int i = 0; i < num_lanes; i++) {
+		uint8_t tmp[8];
+		if (fread(tmp, sizeof(tmp), 1, in) != 1) {
+			fprintf(stderr, "Couldn't read header\n");
+			exit(EXIT_FAILURE);
+		}
+
+		uint64_t size = 0;
+		for (int j = 0; j < 8; j++)
+			size = (size << 8) | tmp[j];
+
+		if (size > SIZE_MAX) {
+			fprintf(stderr, "Invalid lane size\n");
+			exit(EXIT_FAILURE);
+		}
+
+		lane_size[i] = size;
+	}
+
+	return num_lanes;
+}
+
+/* writes the segments completely, iov is modified */
+static void write_segments(int fd, struct iovec iov[], int iovcnt)
+{
+	while (iovcnt > 0) {
+		ssize_t len = writev(fd, iov, iovcnt);
+		if (len < 0) {
+			perror("Error while writing output symbols");
+			exit(EXIT_FAILURE);
+		}
+
+		for (; iovcnt > 0 && (size_t)len >= iov->iov_len; iov++, iovcnt--)
+			len -= iov->iov_len;
+
+		if (iovcnt > 0) {
+			iov->iov_base = (uint8_t *)iov->iov_base + len;
+			iov->iov_len -= len;
+		}
+	}
+}
+
+/* Like huff_decode_file, but the symbols are decoded into segments which
+ * are written with one writev. */
+static void decode_file_iov(const struct huff_dec *dec, size_t num_sym,
+							struct bit_reader *reader, FILE *out)
+{
+	uint8_t *buffer = malloc(IOV_SEGMENTS * IOV_SEGMENT_SIZE);
+	if (buffer == NULL) {
+		perror("Couldn't allocate segments");
+		exit(EXIT_FAILURE);
+	}
+
+	if (fflush(out) != 0) {
+		perror("Couldn't write output");
+		exit(EXIT_FAILURE);
+	}
+
+	while (num_sym > 0) {
+		struct iovec iov[IOV_SEGMENTS];
+		int iovcnt = 0;
+
+		for (; iovcnt < IOV_SEGMENTS && num_sym > 0; iovcnt++) {
+			size_t len = (num_sym < IOV_SEGMENT_SIZE) ? num_sym : IOV_SEGMENT_SIZE;
+			iov[iovcnt].iov_base = &buffer[iovcnt * IOV_SEGMENT_SIZE];
+			iov[iovcnt].iov_len = len;
+			num_sym -= len;
+		}
+
+		if (!huff_decode_iov(dec, reader, iov, iovcnt)) {
+			fprintf(stderr, "Error while decoding\n");
+			exit(EXIT_FAILURE);
+		}
+
+		write_segments(fileno(out), iov, iovcnt);
+	}
+
+	free(buffer);
+}
+
+static void decode_lanes(FILE *in, FILE *out, const struct huff_dec *dec,
+						 size_t num_sym, uint8_t num_lanes,
+						 const size_t lane_size[])
+{
+	size_t total = 0;
+	for (int i = 0; i < num_lanes; i++) {
+		if (lane_size[i] > SIZE_MAX - HUFF_LANE_SLACK - total) {
+			fprintf(stderr, "Invalid lane size\n");
+			exit(EXIT_FAILURE);
+		}
+
+		total += lane_size[i];
+	}
+
+	uint8_t *lanes = calloc(total + HUFF_LANE_SLACK, 1);
+	uint8_t *symbols = malloc(num_sym);
+	if (lanes == NULL || (symbols == NULL && num_sym != 0)) {
+		perror("Couldn't allocate lanes");
+		exit(EXIT_FAILURE);
+	}
+
+	if (fread(lanes, 1, total, in) != total) {
+		fprintf(stderr, "Couldn't read lanes\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (!huff_decode_lanes(dec, num_sym, lanes, lane_size, num_lanes, symbols)) {
+		fprintf(stderr, "Error while decoding\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (fwrite(symbols, 1, num_sym, out) != num_sym) {
+		fprintf(stderr, "Error while writing output symbols\n");
+		exit(EXIT_FAILURE);
+	}
+
+	free(symbols);
+	free(lanes);
+}
+
+static void decode_range(FILE *in, FILE *out, const struct huff_dec *dec,
+						 size_t num_sym, struct huff_seek *seek)
+{
+	if (range_offset > num_sym || range_len > num_sym - range_offset) {
+		fprintf(stderr, "Range exceeds the %zu symbols of the input\n", num_sym);
+		exit(EXIT_FAILURE);
+	}
+
+	uint8_t *symbols = malloc(range_len);
+	if (symbols == NULL && range_len != 0) {
+		perror("Couldn't allocate output buffer");
+		exit(EXIT_FAILURE);
+	}
+
+	if (!huff_seek_start(seek, in) ||
+		!huff_decode_range(dec, seek, in, range_offset, range_len, symbols)) {
+		fprintf(stderr, "Error while decoding\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (fwrite(symbols, 1, range_len, out) != range_len) {
+		fprintf(stderr, "Error while writing output symbols\n");
+		exit(EXIT_FAILURE);
+	}
+
+	free(symbols);
+}
+
+/* BLK and FLS segments hold a single 64 bit value */
+static uint64_t read_count(FILE *in)
+{
+	uint8_t header[10];
+	if (fread(header, sizeof(header), 1, in) != 1) {
+		fprintf(stderr, "Couldn't read header\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (header[0] != 0 || header[1] != 10) {
+		fprintf(stderr, "Invalid segment length\n");
+		exit(EXIT_FAILURE);
+	}
+
+	uint64_t size = 0;
+	for (int i = 0; i < 8; i++)
+		size = (size << 8) | header[2 + i];
+
+	if (size > SIZE_MAX) {
+		fprintf(stderr, "Invalid segment value\n");
+		exit(EXIT_FAILURE);
+	}
+
+	return size;
+}
+
+static enum huff_transform read_xfm(FILE *in)
+{
+	uint8_t header[3];
+	if (fread(header, sizeof(header), 1, in) != 1 ||
+		header[0] != 0 || header[1] != 3 || header[2] >= HUFF_NUM_TRANSFORMS) {
+		fprintf(stderr, "Invalid transform\n");
+		exit(EXIT_FAILURE);
+	}
+
+	return header[2];
+}
+
+static uint32_t read_crc(FILE *in)
+{
+	uint8_t header[6];
+	if (fread(header, sizeof(header), 1, in) != 1 ||
+		header[0] != 0 || header[1] != 6) {
+		fprintf(stderr, "Invalid checksum\n");
+		exit(EXIT_FAILURE);
+	}
+
+	return ((uint32_t)header[2] << 24) | ((uint32_t)header[3] << 16) |
+		((uint32_t)header[4] << 8) | header[5];
+}
 
+/* Every block has its own table: BLK, optional CRC and XFM, DHT, DNL and
+ * entropy data. The BLK segment holds the size of the entropy data, so the
+ * block is read into memory and the next block starts right after it. */
+struct block {
 	struct huff_dec dec;
-	if (!huff_gen_dec(&header[5], symbols, &dec)) {
-		fprintf(stderr, "Couldn't create decoder\n");
+	struct huff_untransform untransform;
+	bool has_crc;
+	uint32_t crc; /* of the decoded data */
+	uint8_t symbols[256]; /* of the DHT */
+	uint16_t num_symbols;
+	size_t num_sym;
+
+	uint8_t *data; /* reused for the next block */
+	size_t data_size;
+};
+
+/* reads the block after its BLK marker */
+static void read_block(FILE *in, struct block *block, struct huff_stats *stats)
+{
+	uint8_t marker[2];
+	size_t data_size = read_count(in);
+
+	block->dec = (struct huff_dec){ .stats = stats, .mode = dec_mode };
+	block->has_crc = false;
+
+	if (fread(marker, sizeof(marker), 1, in) != 1) {
+		fprintf(stderr, "Invalid block header\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (marker[0] == 0xFF && marker[1] == JPG_CRC) {
+		block->crc = read_crc(in);
+		block->has_crc = true;
+
+		if (fread(marker, sizeof(marker), 1, in) != 1) {
+			fprintf(stderr, "Invalid block header\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (marker[0] == 0xFF && marker[1] == JPG_XFM) {
+		huff_untransform_init(&block->untransform, read_xfm(in));
+		block->dec.untransform = &block->untransform;
+
+		if (fread(marker, sizeof(marker), 1, in) != 1) {
+			fprintf(stderr, "Invalid block header\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (marker[0] != 0xFF || marker[1] != JPG_DHT ||
+		!read_dht_symbols(in, &block->dec, block->symbols,
+						  &block->num_symbols)) {
+		fprintf(stderr, "Invalid block header\n");
+		exit(EXIT_FAILURE);
+	}
+
+	block->num_sym = read_num_sym(in);
+
+	uint8_t *tmp = realloc(block->data, data_size + 1);
+	if (tmp == NULL) {
+		perror("Couldn't allocate block");
+		exit(EXIT_FAILURE);
+	}
+	block->data = tmp;
+	block->data_size = data_size;
+
+	if (fread(block->data, 1, data_size, in) != data_size) {
+		fprintf(stderr, "Couldn't read block\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void check_crc(const struct block *block, uint32_t crc,
+					  uint64_t index)
+{
+	if (block->has_crc && crc != block->crc) {
+		fprintf(stderr, "Checksum mismatch in block %llu\n",
+				(unsigned long long)index);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void decode_blocks(FILE *in, FILE *out, struct huff_stats *stats)
+{
+	uint8_t marker[2] = { 0xFF, JPG_BLK };
+	struct block block = { .data = NULL };
+	uint64_t index = 0;
+
+	if (range_mode) {
+		fprintf(stderr, "Ranges can't be decoded from blocks\n");
+		exit(EXIT_FAILURE);
+	}
+
+	do {
+		if (marker[0] != 0xFF || marker[1] != JPG_BLK) {
+			fprintf(stderr, "Invalid block header\n");
+			exit(EXIT_FAILURE);
+		}
+
+		read_block(in, &block, stats);
+
+		uint32_t crc = 0;
+		block.dec.crc = block.has_crc ? &crc : NULL;
+
+		struct bit_reader reader;
+		bit_reader_init_mem(&reader, block.data, block.data_size);
+
+		if (!huff_decode_file(&block.dec, block.num_sym, &reader, out)) {
+			fprintf(stderr, "Error while decoding\n");
+			exit(EXIT_FAILURE);
+		}
+
+		check_crc(&block, crc, index++);
+		huff_cache_release(&block.dec);
+	} while (fread(marker, sizeof(marker), 1, in) == 1);
+
+	free(block.data);
+
+	if (stats != NULL)
+		stats->in_bytes += ftell(in);
+}
+
+/* Entropy data of a stream is collected until the FLS segment of a flush
+ * point, the data before it is decoded and written out right away. */
+static void decode_stream(FILE *in, FILE *out, struct huff_stats *stats)
+{
+	uint8_t header[2];
+	uint8_t marker[2];
+	struct huff_dec dec = { .stats = stats, .mode = dec_mode };
+
+	if (range_mode) {
+		fprintf(stderr, "Ranges can't be decoded from streams\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (fread(header, sizeof(header), 1, in) != 1 ||
+		header[0] != 0 || header[1] != 2 ||
+		fread(marker, sizeof(marker), 1, in) != 1 ||
+		marker[0] != 0xFF || marker[1] != JPG_DHT || !read_dht(in, &dec)) {
+		fprintf(stderr, "Invalid stream header\n");
+		exit(EXIT_FAILURE);
+	}
+
+	size_t capacity = 4096;
+	size_t size = 0;
+	uint8_t *data = malloc(capacity);
+	if (data == NULL) {
+		perror("Couldn't allocate stream buffer");
+		exit(EXIT_FAILURE);
+	}
+
+	int c;
+	while ((c = getc(in)) != EOF) {
+		if (size + 2 > capacity) {
+			capacity *= 2;
+			uint8_t *tmp = realloc(data, capacity);
+			if (tmp == NULL) {
+				perror("Couldn't allocate stream buffer");
+				exit(EXIT_FAILURE);
+			}
+			data = tmp;
+		}
+
+		data[size++] = c;
+		if (c != 0xFF)
+			continue;
+
+		c = getc(in);
+		if (c == 0x00) {
+			data[size++] = 0x00; /* the stuffing is kept for the bit reader */
+		} else if (c == JPG_FLS) {
+			size_t num_sym = read_count(in);
+			struct bit_reader reader;
+			bit_reader_init_mem(&reader, data, size - 1);
+
+			if (!huff_decode_file(&dec, num_sym, &reader, out) ||
+				fflush(out) != 0) {
+				fprintf(stderr, "Error while decoding\n");
+				exit(EXIT_FAILURE);
+			}
+
+			size = 0;
+		} else if (c == JPG_EOI || c == EOF) {
+			break;
+		} else {
+			fprintf(stderr, "Invalid marker in stream\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (c == EOF) {
+		fprintf(stderr, "Stream ended without EOI marker\n");
+		exit(EXIT_FAILURE);
+	}
+
+	free(data);
+	huff_cache_release(&dec);
+
+	/* unknown for pipes */
+	long pos = ftell(in);
+	if (stats != NULL && pos > 0)
+		stats->in_bytes += pos;
+}
+
+/* 16 bit symbols are written as little endian samples */
+static void decode_wide(FILE *in, FILE *out, struct huff_stats *stats)
+{
+	if (range_mode) {
+		fprintf(stderr, "Ranges can't be decoded from 16 bit symbols\n");
+		exit(EXIT_FAILURE);
+	}
+
+	struct huff_wide_dec dec = { .stats = stats };
+	if (!huff_wide_read_wht(in, &dec))
+		exit(EXIT_FAILURE);
+
+	size_t num_sym = read_num_sym(in);
+	struct bit_reader *reader = bit_reader_create(in);
+	if (reader == NULL) {
+		fprintf(stderr, "Couldn't create bit reader\n");
+		exit(EXIT_FAILURE);
+	}
+
+	uint16_t samples[DECODE_WIDE_CHUNK];
+	uint8_t bytes[2 * DECODE_WIDE_CHUNK];
+
+	while (num_sym > 0) {
+		size_t len = (num_sym < DECODE_WIDE_CHUNK) ? num_sym : DECODE_WIDE_CHUNK;
+		if (!huff_wide_decode(&dec, len, reader, samples)) {
+			fprintf(stderr, "Error while decoding\n");
+			exit(EXIT_FAILURE);
+		}
+
+		for (size_t i = 0; i < len; i++) {
+			bytes[2 * i] = samples[i] & 0xFF;
+			bytes[2 * i + 1] = samples[i] >> 8;
+		}
+
+		if (fwrite(bytes, 2, len, out) != len) {
+			fprintf(stderr, "Error while writing output symbols\n");
+			exit(EXIT_FAILURE);
+		}
+
+		num_sym -= len;
+	}
+
+	bit_reader_destroy(reader);
+	huff_wide_dec_destroy(&dec);
+
+	if (stats != NULL)
+		stats->in_bytes += ftell(in);
+}
+
+void decode(FILE *in, FILE *out, struct huff_stats *stats)
+{
+	/* an empty input is an empty file */
+	int c = getc(in);
+	if (c == EOF && !ferror(in))
+		return;
+	ungetc(c, in);
+
+	uint8_t marker[2];
+	if (fread(marker, sizeof(marker), 1, in) != 1) {
+		fprintf(stderr, "Couldn't read header\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (marker[0] == 0xFF && marker[1] == JPG_BLK) {
+		decode_blocks(in, out, stats);
+		return;
+	}
+
+	if (marker[0] == 0xFF && marker[1] == JPG_STR) {
+		decode_stream(in, out, stats);
+		return;
+	}
+
+	if (marker[0] == 0xFF && marker[1] == JPG_WHT) {
+		decode_wide(in, out, stats);
+		return;
+	}
+
+	size_t lane_size[HUFF_MAX_LANES];
+	uint8_t num_lanes = 0;
+
+	if (marker[0] == 0xFF && marker[1] == JPG_ILV) {
+		num_lanes = read_ilv(in, lane_size);
+
+		if (fread(marker, sizeof(marker), 1, in) != 1) {
+			fprintf(stderr, "Couldn't read header\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* without a seek table a range is decoded from the start */
+	struct huff_seek seek = { .interval = 1 };
+
+	while (marker[0] == 0xFF && marker[1] == JPG_SKT) {
+		if (!huff_seek_read(in, &seek))
+			exit(EXIT_FAILURE);
+
+		if (fread(marker, sizeof(marker), 1, in) != 1) {
+			fprintf(stderr, "Couldn't read header\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* lanes always use the table, whatever --canonical says */
+	struct huff_dec dec = {
+		.stats = stats,
+		.mode = (num_lanes > 0) ? HUFF_DEC_TABLE : dec_mode
+	};
+
+	if (marker[0] == 0xFF && marker[1] == JPG_DHT) {
+		if (!read_dht(in, &dec)) {
+			huff_seek_destroy(&seek);
+			return;
+		}
+	} else if (marker[0] == 0xFF && marker[1] == JPG_DTR) {
+		read_dtr(in, &dec);
+	} else {
+		fprintf(stderr, "Invalid header\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* how many bytes for the output or how many symbols to read */
+	size_t num_sym = read_num_sym(in);
+
+	if (range_mode) {
+		if (num_lanes > 0) {
+			fprintf(stderr, "Ranges can't be decoded from lanes\n");
+			exit(EXIT_FAILURE);
+		}
+
+		decode_range(in, out, &dec, num_sym, &seek);
+		huff_seek_destroy(&seek);
+		huff_cache_release(&dec);
+		return;
+	}
+
+	huff_seek_destroy(&seek);
+
+	if (num_lanes > 0) {
+		decode_lanes(in, out, &dec, num_sym, num_lanes, lane_size);
+		huff_cache_release(&dec);
+
+		if (stats != NULL)
+			stats->in_bytes += ftell(in);
+		return;
+	}
+
+	struct bit_reader *reader = bit_reader_create(in);
+
+	if (reader == NULL) {
+		fprintf(stderr, "Couldn't create bit reader\n");
+		exit(EXIT_FAILURE);
+	}
+
+	decode_file_iov(&dec, num_sym, reader, out);
+
+	bit_reader_destroy(reader);
+	huff_cache_release(&dec);
+
+	if (stats != NULL)
+		stats->in_bytes += ftell(in);
+}
+
+static void print_match(uint64_t offset, void *arg)
+{
+	(void)arg;
+	printf("%llu\n", (unsigned long long)offset);
+}
+
+/* A block in which no match can start is only decoded as far as a match
+ * from the block before can reach. The table of a transformed block has the
+ * transformed symbols, these blocks are always decoded. The checksum is
+ * checked for completely decoded blocks. */
+static void search_blocks(FILE *in, struct huff_search *search,
+						  struct huff_stats *stats)
+{
+	uint8_t marker[2] = { 0xFF, JPG_BLK };
+	struct block block = { .data = NULL };
+	uint64_t index = 0;
+
+	do {
+		if (marker[0] != 0xFF || marker[1] != JPG_BLK) {
+			fprintf(stderr, "Invalid block header\n");
+			exit(EXIT_FAILURE);
+		}
+
+		read_block(in, &block, stats);
+
+		struct bit_reader reader;
+		bit_reader_init_mem(&reader, block.data, block.data_size);
+
+		bool skip = block.dec.untransform == NULL &&
+			!huff_search_can_start(search, block.symbols, block.num_symbols);
+		uint32_t crc = 0;
+		block.dec.crc = (block.has_crc && !skip) ? &crc : NULL;
+
+		bool ok;
+		if (skip)
+			ok = huff_search_skip(search, &block.dec, block.num_sym, &reader);
+		else
+			ok = huff_search_decode(search, &block.dec, block.num_sym, &reader);
+
+		if (!ok) {
+			fprintf(stderr, "Error while decoding\n");
+			exit(EXIT_FAILURE);
+		}
+
+		if (!skip)
+			check_crc(&block, crc, index);
+		index++;
+		huff_cache_release(&block.dec);
+	} while (fread(marker, sizeof(marker), 1, in) == 1);
+
+	free(block.data);
+}
+
+/* searches plain files and blocks, the matches are printed to stdout */
+static void search_file(FILE *in, struct huff_search *search,
+						struct huff_stats *stats)
+{
+	int c = getc(in);
+	if (c == EOF && !ferror(in))
+		return;
+	ungetc(c, in);
+
+	uint8_t marker[2];
+	if (fread(marker, sizeof(marker), 1, in) != 1) {
+		fprintf(stderr, "Couldn't read header\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (marker[0] == 0xFF && marker[1] == JPG_BLK) {
+		search_blocks(in, search, stats);
+
+		if (stats != NULL)
+			stats->in_bytes += ftell(in);
+		return;
+	}
+
+	/* the seek table isn't needed */
+	while (marker[0] == 0xFF && marker[1] == JPG_SKT) {
+		struct huff_seek seek = { .interval = 1 };
+		if (!huff_seek_read(in, &seek))
+			exit(EXIT_FAILURE);
+		huff_seek_destroy(&seek);
+
+		if (fread(marker, sizeof(marker), 1, in) != 1) {
+			fprintf(stderr, "Couldn't read header\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	struct huff_dec dec = { .stats = stats, .mode = dec_mode };
+	uint8_t dht_symbols[256];
+	uint16_t num_symbols;
+	const uint8_t *symbols = dht_symbols;
+
+	if (marker[0] == 0xFF && marker[1] == JPG_DHT) {
+		if (!read_dht_symbols(in, &dec, dht_symbols, &num_symbols))
+			return;
+	} else if (marker[0] == 0xFF && marker[1] == JPG_DTR) {
+		const struct huff_table *table = read_dtr(in, &dec);
+		symbols = table->symbols;
+		num_symbols = table->num_codes;
+	} else {
+		fprintf(stderr, "Only plain files and blocks can be searched\n");
 		exit(EXIT_FAILURE);
 	}
+
+	size_t num_sym = read_num_sym(in);
 	struct bit_reader *reader = bit_reader_create(in);
 
 	if (reader == NULL) {
@@ -82,47 +886,553 @@ void decode(FILE *in, FILE *out)
 		exit(EXIT_FAILURE);
 	}
 
-	if (!huff_decode_file(&dec, num_sym, reader, out)) {
+	/* all data has one table, without a symbol of the pattern nothing is
+	 * decoded */
+	bool ok;
+	if (huff_search_can_match(search, symbols, num_symbols))
+		ok = huff_search_decode(search, &dec, num_sym, reader);
+	else
+		ok = huff_search_skip(search, &dec, num_sym, reader);
+
+	if (!ok) {
 		fprintf(stderr, "Error while decoding\n");
 		exit(EXIT_FAILURE);
 	}
 
 	bit_reader_destroy(reader);
-	huff_destroy(&dec);
+	huff_cache_release(&dec);
+
+	if (stats != NULL)
+		stats->in_bytes += ftell(in);
 }
 
-int main(int argc, char *argv[])
+static void search_path(const char *in_name, const char *pattern,
+						struct huff_stats *stats)
 {
-	errno = 0;
+	struct huff_search search;
+	if (!huff_search_init(&search, (const uint8_t *)pattern, strlen(pattern),
+						  print_match, NULL))
+		exit(EXIT_FAILURE);
 
-	if (argc > 1)
-		prog_name = argv[0];
-	
-	if (argc != 3 && argc != 2)
-		usage();
-	
-	FILE *in = fopen(argv[1], "rb");
+	FILE *in = fopen(in_name, "rb");
+	if (in == NULL) {
+		perror("Couldn't open input file");
+		exit(EXIT_FAILURE);
+	}
+
+	search_file(in, &search, stats);
+
+	fclose(in);
+	huff_search_destroy(&search);
+
+	/* like grep: 1 if nothing was found */
+	if (search.num_matches == 0)
+		exit_status = 1;
+}
+
+/* out_name NULL writes to stdout */
+static void decode_path(const char *in_name, const char *out_name,
+						struct huff_stats *stats)
+{
+	FILE *in = fopen(in_name, "rb");
 	if (in == NULL) {
 		perror("Couldn't open input file");
-		return EXIT_FAILURE;
+		exit(EXIT_FAILURE);
 	}
 
 	FILE *out;
-	if (argc == 3) {
-		out = fopen(argv[2], "wb");
+	if (out_name != NULL) {
+		out = fopen(out_name, "wb");
 		if (out == NULL) {
 			perror("Couldn't open output file");
-			return EXIT_FAILURE;
+			exit(EXIT_FAILURE);
 		}
 	} else {
 		out = stdout;
 	}
 
-	decode(in, out);
+	decode(in, out, stats);
 
 	fclose(in);
 	fclose(out);
+}
+
+/* Multi file mode: every file or archive entry is one task on the pool. */
+#define MULTI_SUFFIX ".huf"
+
+struct multi_task {
+	const char *in_name; /* NULL for an archive entry */
+	char *out_name;
+	uint8_t *data;
+	size_t size;
+};
+
+static pthread_mutex_t multi_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct huff_stats *multi_stats;
+
+/* an existing file is only replaced with --force */
+static FILE *open_output(const char *name)
+{
+	FILE *out = NULL;
+
+	if (force) {
+		out = fopen(name, "wb");
+	} else {
+		int fd = open(name, O_WRONLY | O_CREAT | O_EXCL, 0666);
+		if (fd != -1 && (out = fdopen(fd, "wb")) == NULL)
+			close(fd);
+	}
+
+	if (out == NULL) {
+		bool exists = (errno == EEXIST);
+		perror(name);
+		if (exists)
+			fprintf(stderr, "Use --force to replace existing files\n");
+		exit(EXIT_FAILURE);
+	}
+
+	return out;
+}
+
+static void decode_task(void *arg)
+{
+	struct multi_task *task = arg;
+	struct huff_stats stats;
+	memset(&stats, 0, sizeof(stats));
+	struct huff_stats *stats_ptr = (multi_stats != NULL) ? &stats : NULL;
+
+	FILE *in = NULL;
+
+	if (task->in_name != NULL) {
+		in = fopen(task->in_name, "rb");
+		if (in == NULL) {
+			perror(task->in_name);
+			exit(EXIT_FAILURE);
+		}
+	} else if (task->size > 0) {
+		/* fmemopen doesn't take empty buffers */
+		in = fmemopen(task->data, task->size, "rb");
+		if (in == NULL) {
+			perror("Couldn't open archive entry");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	FILE *out = open_output(task->out_name);
+	if (in != NULL) {
+		decode(in, out, stats_ptr);
+		fclose(in);
+	}
+
+	fclose(out);
+
+	if (multi_stats != NULL) {
+		pthread_mutex_lock(&multi_lock);
+		huff_stats_merge(multi_stats, &stats);
+		pthread_mutex_unlock(&multi_lock);
+	}
+
+	free(task->data);
+	free(task->out_name);
+	free(task);
+}
+
+static struct multi_task *new_task(const char *in_name, size_t name_len)
+{
+	struct multi_task *task = calloc(1, sizeof(*task));
+	char *out_name = malloc(name_len + 1);
+	if (task == NULL || out_name == NULL) {
+		perror("Couldn't allocate task");
+		exit(EXIT_FAILURE);
+	}
+
+	task->in_name = in_name;
+	task->out_name = out_name;
+	return task;
+}
+
+/* FILE.huf is decoded to FILE */
+static void decode_multi(char *names[], size_t num_files,
+						 struct huff_pool *pool)
+{
+	for (size_t i = 0; i < num_files; i++) {
+		size_t len = strlen(names[i]);
+		size_t suffix_len = strlen(MULTI_SUFFIX);
+		if (len <= suffix_len ||
+			strcmp(names[i] + len - suffix_len, MULTI_SUFFIX) != 0) {
+			fprintf(stderr, "File name doesn't end with %s: %s\n",
+					MULTI_SUFFIX, names[i]);
+			exit(EXIT_FAILURE);
+		}
+
+		struct multi_task *task = new_task(names[i], len - suffix_len);
+		memcpy(task->out_name, names[i], len - suffix_len);
+		task->out_name[len - suffix_len] = '\0';
+
+		if (!huff_pool_submit(pool, decode_task, task))
+			exit(EXIT_FAILURE);
+	}
+}
+
+/* no absolute names and no .. components */
+static bool safe_name(const char *name)
+{
+	if (name[0] == '/' || name[0] == '\0')
+		return false;
+
+	for (const char *pos = name; pos != NULL; pos = strchr(pos, '/')) {
+		if (*pos == '/')
+			pos++;
+		if (strncmp(pos, "..", 2) == 0 && (pos[2] == '/' || pos[2] == '\0'))
+			return false;
+	}
+
+	return true;
+}
+
+/* creates the parent directories of path */
+static void make_dirs(char *path)
+{
+	for (char *pos = strchr(path + 1, '/'); pos != NULL;
+		 pos = strchr(pos + 1, '/')) {
+		*pos = '\0';
+		if (mkdir(path, 0777) != 0 && errno != EEXIST) {
+			perror(path);
+			exit(EXIT_FAILURE);
+		}
+		*pos = '/';
+	}
+}
+
+/* The archive is read by the main thread, every entry is decoded on the
+ * pool into DIR */
+static void extract(const char *archive_name, const char *dir_name,
+					struct huff_pool *pool)
+{
+	FILE *archive = fopen(archive_name, "rb");
+	if (archive == NULL) {
+		perror("Couldn't open archive");
+		exit(EXIT_FAILURE);
+	}
+
+	uint8_t header[12];
+	while (fread(header, sizeof(header), 1, archive) == 1) {
+		uint16_t length = (header[2] << 8) | header[3];
+		if (header[0] != 0xFF || header[1] != JPG_ARC || length <= 10) {
+			fprintf(stderr, "Invalid archive entry\n");
+			exit(EXIT_FAILURE);
+		}
+
+		uint64_t size = 0;
+		for (int i = 0; i < 8; i++)
+			size = (size << 8) | header[4 + i];
+
+		if (size > SIZE_MAX) {
+			fprintf(stderr, "Invalid archive entry\n");
+			exit(EXIT_FAILURE);
+		}
+
+		size_t name_len = length - 10;
+		size_t dir_len = strlen(dir_name);
+
+		struct multi_task *task = new_task(NULL, dir_len + 1 + name_len);
+		memcpy(task->out_name, dir_name, dir_len);
+		task->out_name[dir_len] = '/';
+		task->out_name[dir_len + 1 + name_len] = '\0';
+		task->data = malloc(size);
+		task->size = size;
+
+		if ((size > 0 && task->data == NULL) ||
+			fread(task->out_name + dir_len + 1, 1, name_len, archive) != name_len ||
+			fread(task->data, 1, size, archive) != size) {
+			fprintf(stderr, "Couldn't read archive entry\n");
+			exit(EXIT_FAILURE);
+		}
+
+		const char *name = task->out_name + dir_len + 1;
+		if (memchr(name, '\0', name_len) != NULL || !safe_name(name)) {
+			fprintf(stderr, "Invalid file name in archive\n");
+			exit(EXIT_FAILURE);
+		}
+
+		make_dirs(task->out_name);
+		if (!huff_pool_submit(pool, decode_task, task))
+			exit(EXIT_FAILURE);
+	}
+
+	fclose(archive);
+}
+
+/* dictionaries stay loaded until the process exits */
+static void load_dict(const char *name)
+{
+	struct huff_table *table = malloc(sizeof(*table));
+	FILE *dict_file = fopen(name, "rb");
+	if (table == NULL || dict_file == NULL) {
+		perror("Couldn't open dictionary file");
+		exit(EXIT_FAILURE);
+	}
+
+	if (!huff_table_read(dict_file, table) || !huff_table_register(table))
+		exit(EXIT_FAILURE);
+
+	fclose(dict_file);
+}
+
+/* --verify: the blocks are decoded without output on the pool, at most
+ * VERIFY_BATCH blocks per thread are in memory */
+#define VERIFY_BATCH (2)
+
+struct verify_task {
+	struct block block;
+	uint64_t index;
+	struct huff_stats stats;
+	bool ok;
+};
+
+static void verify_task(void *arg)
+{
+	struct verify_task *task = arg;
+	struct block *block = &task->block;
+
+	uint32_t crc = 0;
+	block->dec.crc = &crc;
+
+	struct bit_reader reader;
+	bit_reader_init_mem(&reader, block->data, block->data_size);
+
+	task->ok = huff_decode_file(&block->dec, block->num_sym, &reader, NULL) &&
+		(!block->has_crc || crc == block->crc);
+
+	huff_cache_release(&block->dec);
+}
+
+/* returns the number of damaged blocks */
+static uint64_t finish_verify(const char *in_name, struct verify_task *tasks[],
+							  size_t num_tasks, struct huff_stats *stats)
+{
+	uint64_t num_damaged = 0;
+
+	for (size_t i = 0; i < num_tasks; i++) {
+		if (!tasks[i]->ok) {
+			fprintf(stderr, "%s: block %llu is damaged\n", in_name,
+					(unsigned long long)tasks[i]->index);
+			num_damaged++;
+		}
+
+		if (stats != NULL)
+			huff_stats_merge(stats, &tasks[i]->stats);
+
+		free(tasks[i]->block.data);
+		free(tasks[i]);
+	}
+
+	return num_damaged;
+}
+
+static bool verify(const char *in_name, struct huff_pool *pool,
+				   unsigned num_threads, struct huff_stats *stats)
+{
+	FILE *in = fopen(in_name, "rb");
+	if (in == NULL) {
+		perror(in_name);
+		exit(EXIT_FAILURE);
+	}
+
+	uint8_t marker[2];
+	if (fread(marker, sizeof(marker), 1, in) != 1 ||
+		marker[0] != 0xFF || marker[1] != JPG_BLK) {
+		fprintf(stderr, "%s: only blocks can be verified\n", in_name);
+		exit(EXIT_FAILURE);
+	}
+
+	size_t batch = VERIFY_BATCH * num_threads;
+	struct verify_task **tasks = malloc(batch * sizeof(*tasks));
+	if (tasks == NULL) {
+		perror("Couldn't allocate tasks");
+		exit(EXIT_FAILURE);
+	}
+
+	size_t num_tasks = 0;
+	uint64_t num_blocks = 0;
+	uint64_t num_crc = 0;
+	uint64_t num_damaged = 0;
+
+	do {
+		if (marker[0] != 0xFF || marker[1] != JPG_BLK) {
+			fprintf(stderr, "Invalid block header\n");
+			exit(EXIT_FAILURE);
+		}
+
+		struct verify_task *task = calloc(1, sizeof(*task));
+		if (task == NULL) {
+			perror("Couldn't allocate task");
+			exit(EXIT_FAILURE);
+		}
+
+		read_block(in, &task->block, (stats != NULL) ? &task->stats : NULL);
+		task->index = num_blocks++;
+		num_crc += task->block.has_crc;
+
+		tasks[num_tasks++] = task;
+		if (!huff_pool_submit(pool, verify_task, task))
+			exit(EXIT_FAILURE);
+
+		if (num_tasks == batch) {
+			huff_pool_wait(pool);
+			num_damaged += finish_verify(in_name, tasks, num_tasks, stats);
+			num_tasks = 0;
+		}
+	} while (fread(marker, sizeof(marker), 1, in) == 1);
+
+	huff_pool_wait(pool);
+	num_damaged += finish_verify(in_name, tasks, num_tasks, stats);
+	free(tasks);
+
+	if (stats != NULL)
+		stats->in_bytes += ftell(in);
+	fclose(in);
+
+	fprintf(stderr, "%s: %llu blocks, %llu with checksum, %llu damaged\n",
+			in_name, (unsigned long long)num_blocks,
+			(unsigned long long)num_crc, (unsigned long long)num_damaged);
+
+	return num_damaged == 0;
+}
+
+int main(int argc, char *argv[])
+{
+	errno = 0;
+
+	if (argc > 1)
+		prog_name = argv[0];
+
+	bool batch = false;
+	bool multi = false;
+	bool verify_mode = false;
+	const char *archive_name = NULL;
+	const char *pattern = NULL;
+	long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	int arg = 1;
+	while (arg < argc && argv[arg][0] == '-') {
+		if (strcmp(argv[arg], "--stats") == 0) {
+			stats_format = STATS_TEXT;
+			arg++;
+		} else if (strcmp(argv[arg], "--stats-json") == 0) {
+			stats_format = STATS_JSON;
+			arg++;
+		} else if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc) {
+			load_dict(argv[arg + 1]);
+			arg += 2;
+		} else if (strcmp(argv[arg], "--range") == 0 && arg + 2 < argc) {
+			char *end1, *end2;
+			range_offset = strtoull(argv[arg + 1], &end1, 10);
+			range_len = strtoull(argv[arg + 2], &end2, 10);
+			if (*end1 != '\0' || *end2 != '\0') {
+				fprintf(stderr, "Invalid range\n");
+				return EXIT_FAILURE;
+			}
+			range_mode = true;
+			arg += 3;
+		} else if (strcmp(argv[arg], "--canonical") == 0) {
+			dec_mode = HUFF_DEC_CANONICAL;
+			arg++;
+		} else if (strcmp(argv[arg], "-m") == 0) {
+			multi = true;
+			arg++;
+		} else if (strcmp(argv[arg], "-x") == 0 && arg + 1 < argc) {
+			archive_name = argv[arg + 1];
+			arg += 2;
+		} else if (strcmp(argv[arg], "-j") == 0 && arg + 1 < argc) {
+			char *end;
+			num_threads = strtol(argv[arg + 1], &end, 10);
+			if (*end != '\0' || num_threads < 1 ||
+				num_threads > HUFF_POOL_MAX_THREADS) {
+				fprintf(stderr, "Number of threads must be between 1 and %d\n",
+						HUFF_POOL_MAX_THREADS);
+				return EXIT_FAILURE;
+			}
+			arg += 2;
+		} else if (strcmp(argv[arg], "--verify") == 0) {
+			verify_mode = true;
+			arg++;
+		} else if (strcmp(argv[arg], "--search") == 0 && arg + 1 < argc) {
+			pattern = argv[arg + 1];
+			arg += 2;
+		} else if (strcmp(argv[arg], "--force") == 0) {
+			force = true;
+			arg++;
+		} else if (strcmp(argv[arg], "--batch") == 0) {
+			batch = true;
+			arg++;
+		} else {
+			usage();
+		}
+	}
+	
+	if (verify_mode &&
+		(batch || range_mode || multi || archive_name != NULL ||
+		 pattern != NULL || argc == arg))
+		usage();
+	else if (pattern != NULL &&
+		(batch || range_mode || multi || archive_name != NULL ||
+		 argc - arg != 1))
+		usage();
+	else if ((multi || archive_name != NULL) &&
+		(batch || range_mode || (multi && archive_name != NULL) ||
+		 (multi && argc == arg) || (archive_name != NULL && argc - arg != 1)))
+		usage();
+	else if (batch && (argc == arg || (argc - arg) % 2 != 0))
+		usage();
+	else if (!batch && !multi && archive_name == NULL && !verify_mode &&
+			 argc - arg != 2 && argc - arg != 1)
+		usage();
+
+	struct huff_stats stats;
+	memset(&stats, 0, sizeof(stats));
+	struct huff_stats *stats_ptr = (stats_format != STATS_NONE) ? &stats : NULL;
+
+	/* one process for many files, files with the same DHT header share the
+	 * cached decode table */
+	if (multi || archive_name != NULL || verify_mode) {
+		if (num_threads < 1)
+			num_threads = 1;
+		else if (num_threads > HUFF_POOL_MAX_THREADS)
+			num_threads = HUFF_POOL_MAX_THREADS;
+
+		struct huff_pool *pool = huff_pool_create(num_threads);
+		if (pool == NULL)
+			return EXIT_FAILURE;
+
+		multi_stats = stats_ptr;
+		if (verify_mode) {
+			for (; arg < argc; arg++) {
+				if (!verify(argv[arg], pool, num_threads, stats_ptr))
+					exit_status = EXIT_FAILURE;
+			}
+		} else if (multi) {
+			decode_multi(argv + arg, argc - arg, pool);
+		} else {
+			extract(archive_name, argv[arg], pool);
+		}
+
+		huff_pool_wait(pool);
+		huff_pool_destroy(pool);
+	} else if (pattern != NULL) {
+		search_path(argv[arg], pattern, stats_ptr);
+	} else if (batch) {
+		for (; arg < argc; arg += 2)
+			decode_path(argv[arg], argv[arg + 1], stats_ptr);
+	} else {
+		decode_path(argv[arg], (argc - arg == 2) ? argv[arg + 1] : NULL,
+					stats_ptr);
+	}
+
+	if (stats_format == STATS_TEXT)
+		huff_stats_print(stderr, &stats);
+	else if (stats_format == STATS_JSON)
+		huff_stats_print_json(stderr, &stats);
 
-	return 0;
+	return exit_status;
 }
 
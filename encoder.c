@@ -6,11 +6,16 @@
  */
 
 #define _POSIX_C_SOURCE 1
+#define _FILE_OFFSET_BITS 64
 #define _DEFAULT_SOURCE 
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -19,14 +24,56 @@
 #include <stdint.h>
 #include "bit_writer.h"
 #include "huff_enc.h"
+#include "huff_table.h"
+#include "huff_lanes.h"
+#include "huff_seek.h"
+#include "huff_split.h"
+#include "huff_stream.h"
+#include "huff_pool.h"
+#include "huff_transform.h"
+#include "huff_wide.h"
+#include "huff_estimate.h"
+#include "huff_crc.h"
+#include "huff_format.h"
 
-#define JPG_DHT		(0xC4)
+#define ENCODE_CHUNK_SIZE (64 * 1024)
+
+/* a plain stream is read and written in segments with readv and writev */
+#define IOV_SEGMENTS (16)
+#define IOV_SEGMENT_SIZE (16 * 1024)
+/* the encoding continues in fresh segments when the output is full */
+#define IOV_OUT_SEGMENT_SIZE (4 * IOV_SEGMENT_SIZE + 8)
 
 static const char *prog_name = "huffenc";
 
+static enum {
+	STATS_NONE,
+	STATS_TEXT,
+	STATS_JSON
+} stats_format = STATS_NONE;
+
+/* --crc: every block has the checksum of its data */
+static bool block_crc = false;
+
+/* --force: -m and -r replace existing FILE.huf */
+static bool force = false;
+
 void usage(void)
 {
-	fprintf(stderr, "USAGE: %s FILE_IN FILE_OUT\n", prog_name);
+	fprintf(stderr, "USAGE: %s [--stats|--stats-json] [-t DICT] [-l LANES] "
+			"[-s INTERVAL] FILE_IN FILE_OUT\n", prog_name);
+	fprintf(stderr, "       %s [--stats|--stats-json] [--crc] -b FILE_IN "
+			"FILE_OUT\n", prog_name);
+	fprintf(stderr, "       %s [--stats|--stats-json] -f SIZE FILE_IN FILE_OUT\n",
+			prog_name);
+	fprintf(stderr, "       %s [--stats|--stats-json] -w FILE_IN FILE_OUT\n",
+			prog_name);
+	fprintf(stderr, "       %s [--stats|--stats-json] [--crc] [-j THREADS] "
+			"[--force] [-a ARCHIVE] -m FILE...\n", prog_name);
+	fprintf(stderr, "       %s [--stats|--stats-json] [--crc] [-j THREADS] "
+			"[--force] [-a ARCHIVE] -r DIR\n", prog_name);
+	fprintf(stderr, "       %s --train [-i ID] [-c HEADER] DICT FILE...\n",
+			prog_name);
 	exit(EXIT_FAILURE);
 }
 
@@ -46,92 +93,1114 @@ static off_t get_file_size(FILE *file)
 	return buf.st_size;
 }
 
-void encode(FILE *in, FILE *out)
+static uint8_t *read_file(FILE *in, off_t *size)
 {
-	off_t size = get_file_size(in);
-	if (size == 0)
-		return;
+	*size = get_file_size(in);
+	if (*size == 0)
+		return NULL;
 
-	uint8_t *data = malloc(size);
+	uint8_t *data = malloc(*size);
 	if (data == NULL)
-		return;
+		return NULL;
 
-	if (fread(data, size, 1, in) != 1) {
+	if (fread(data, *size, 1, in) != 1) {
 		fprintf(stderr, "Couldn't read input data\n");
 		exit(EXIT_FAILURE);
 	}
 
-	uint32_t freq[256];
-	huff_get_freq(data, size, freq);
+	return data;
+}
 
-	struct huff_enc enc;
-	struct huff_enc_info info;
-	if (!huff_gen_enc(freq, &enc, &info)) {
-		fprintf(stderr, "Couldn't create encoder\n");
+static void write_dht(FILE *out, const struct huff_enc *enc,
+					  const struct huff_enc_info *info)
+{
+	if (!huff_enc_write_dht(out, enc, info))
 		exit(EXIT_FAILURE);
-	}
+}
 
-	uint8_t header[21];
+static void write_dtr(FILE *out, uint8_t id)
+{
+	uint8_t header[5];
 	header[0] = 0xFF;
-	header[1] = JPG_DHT;
+	header[1] = JPG_DTR;
+	header[2] = 0;
+	header[3] = 3;
+	header[4] = id;
+
+	if (fwrite(header, sizeof(header), 1, out) != 1) {
+		fprintf(stderr, "Couldn't write header\n");
+		exit(EXIT_FAILURE);
+	}
+}
 
-	uint16_t header_length = 19 + info.num_codes;
+static void write_ilv(FILE *out, uint8_t num_lanes, const size_t lane_size[])
+{
+	uint16_t header_length = 3 + 8 * num_lanes;
+	uint8_t header[5 + 8 * HUFF_MAX_LANES];
+	header[0] = 0xFF;
+	header[1] = JPG_ILV;
 	header[2] = header_length >> 8;
 	header[3] = header_length & 0xFF;
-	
-	header[4] = 0;
+	header[4] = num_lanes;
 
-	for (int i = 0; i < 16; i++) {
-		header[5 + i] = info.codes_per_len[i];
+	for (int i = 0; i < num_lanes; i++) {
+		uint64_t lane = lane_size[i];
+		for (int j = 0; j < 8; j++)
+			header[5 + 8 * i + j] = (lane >> (56 - 8 * j)) & 0xFF;
 	}
-	
-	if (fwrite(header, sizeof(header), 1, out) != 1) {
+
+	if (fwrite(header, 2 + header_length, 1, out) != 1) {
 		fprintf(stderr, "Couldn't write header\n");
 		exit(EXIT_FAILURE);
 	}
+}
 
-	/* write symbols */
-	for (int i = 0; i < 16; i++) {
-		uint16_t num_symbols = info.codes_per_len[i];
+/* the lanes are encoded into memory first, their sizes go into the header */
+static uint8_t *encode_lanes(const struct huff_enc *enc, const uint8_t data[],
+							 off_t size, uint8_t num_lanes, size_t lane_size[],
+							 size_t *total)
+{
+	size_t bound = huff_lanes_bound(size, num_lanes);
+	uint8_t *lanes = malloc(bound);
+	if (lanes == NULL) {
+		perror("Couldn't allocate lanes");
+		exit(EXIT_FAILURE);
+	}
 
-		if (num_symbols == 0)
-			continue;
+	if (!huff_encode_lanes(enc, size, data, num_lanes, lanes, bound, lane_size)) {
+		fprintf(stderr, "Input contains symbols without a code in the table\n");
+		exit(EXIT_FAILURE);
+	}
+
+	*total = 0;
+	for (int i = 0; i < num_lanes; i++)
+		*total += lane_size[i];
+
+	return lanes;
+}
+
+static void write_dnl(FILE *out, uint64_t num_sym)
+{
+	uint8_t header[12];
+	header[0] = 0xFF;
+	header[1] = JPG_DNL;
+	header[2] = 0;
+	header[3] = 10;
+
+	for (int i = 0; i < 8; i++)
+		header[4 + i] = (num_sym >> (56 - 8 * i)) & 0xFF;
+
+	if (fwrite(header, sizeof(header), 1, out) != 1) {
+		fprintf(stderr, "Couldn't write number of bytes\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/* reads the input in chunks, so its size isn't limited by the memory */
+static void get_freq_file(FILE *in, uint64_t freq[256])
+{
+	uint8_t buffer[ENCODE_CHUNK_SIZE];
+	size_t len;
+
+	for (int i = 0; i < 256; i++)
+		freq[i] = 0;
+
+	while ((len = fread(buffer, 1, sizeof(buffer), in)) > 0)
+		huff_add_freq(buffer, len, freq);
+
+	if (ferror(in)) {
+		fprintf(stderr, "Couldn't read input data\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void encode_file(const struct huff_enc *enc, FILE *in, uint64_t size,
+						FILE *out, struct huff_seek *seek)
+{
+	uint8_t buffer[ENCODE_CHUNK_SIZE];
+	struct bit_writer *writer = bit_writer_create(out);
 
-		uint8_t symbols[num_symbols];
+	while (size > 0) {
+		size_t len = (size < sizeof(buffer)) ? size : sizeof(buffer);
+		if (fread(buffer, len, 1, in) != 1) {
+			fprintf(stderr, "Couldn't read input data\n");
+			exit(EXIT_FAILURE);
+		}
 
-		uint16_t sym_index = 0;
-		for (int j = 0; j < info.num_codes; j++) {
-			if (enc.codes[j].code_len != (i + 1))
-				continue;
-			
-			symbols[sym_index] = enc.codes[j].symbol;
-			sym_index++;
+		bool ok = (seek != NULL) ? huff_encode_seek(enc, seek, len, buffer, writer)
+			: huff_encode(enc, len, buffer, writer);
+		if (!ok) {
+			fprintf(stderr, "Input contains symbols without a code in the table\n");
+			exit(EXIT_FAILURE);
 		}
-		
-		if (fwrite(symbols, num_symbols, 1, out) != 1) {
-			fprintf(stderr, "Couldn't write header\n");
+
+		size -= len;
+	}
+
+	bit_writer_destroy(writer);
+}
+
+/* fills the segments completely, iov is modified */
+static void read_segments(int fd, struct iovec iov[], int iovcnt)
+{
+	while (iovcnt > 0) {
+		ssize_t len = readv(fd, iov, iovcnt);
+		if (len <= 0) {
+			fprintf(stderr, "Couldn't read input data\n");
 			exit(EXIT_FAILURE);
 		}
+
+		for (; iovcnt > 0 && (size_t)len >= iov->iov_len; iov++, iovcnt--)
+			len -= iov->iov_len;
+
+		if (iovcnt > 0) {
+			iov->iov_base = (uint8_t *)iov->iov_base + len;
+			iov->iov_len -= len;
+		}
 	}
+}
 
-	/* write uint32_t num_data_symbols */
-	uint8_t num_bytes[4];
-	num_bytes[0] = (size >> 24) & 0xFF;
-	num_bytes[1] = (size >> 16) & 0xFF;
-	num_bytes[2] = (size >>  8) & 0xFF;
-	num_bytes[3] = size & 0xFF;
+/* writes the first size bytes of the segments, iov is modified */
+static void write_segments(int fd, struct iovec iov[], size_t size)
+{
+	int cnt = 0;
+	for (size_t left = size; left > 0; cnt++) {
+		if (iov[cnt].iov_len > left)
+			iov[cnt].iov_len = left;
+		left -= iov[cnt].iov_len;
+	}
 
-	if (fwrite(num_bytes, 4, 1, out) != 1) {
-		fprintf(stderr, "Couldn't write number of bytes\n");
+	while (cnt > 0) {
+		ssize_t len = writev(fd, iov, cnt);
+		if (len < 0) {
+			perror("Couldn't write output data");
+			exit(EXIT_FAILURE);
+		}
+
+		for (; cnt > 0 && (size_t)len >= iov->iov_len; iov++, cnt--)
+			len -= iov->iov_len;
+
+		if (cnt > 0) {
+			iov->iov_base = (uint8_t *)iov->iov_base + len;
+			iov->iov_len -= len;
+		}
+	}
+
+}
+
+static void split_segments(uint8_t buffer[], size_t seg_size, size_t size,
+						   struct iovec iov[], int *iovcnt)
+{
+	*iovcnt = 0;
+	for (size_t pos = 0; pos < size; pos += seg_size) {
+		iov[*iovcnt].iov_base = &buffer[pos];
+		iov[*iovcnt].iov_len = (size - pos < seg_size) ? size - pos : seg_size;
+		(*iovcnt)++;
+	}
+}
+
+/* drops the first len bytes of the segments, iov is modified */
+static void skip_segments(struct iovec **iov, int *iovcnt, size_t len)
+{
+	while (*iovcnt > 0 && len >= (*iov)->iov_len) {
+		len -= (*iov)->iov_len;
+		(*iov)++;
+		(*iovcnt)--;
+	}
+
+	if (*iovcnt > 0) {
+		(*iov)->iov_base = (uint8_t *)(*iov)->iov_base + len;
+		(*iov)->iov_len -= len;
+	}
+}
+
+/* Like encode_file, but the data goes from readv through the segments
+ * straight to writev. The stdio streams are only used for the headers. */
+static void encode_file_iov(const struct huff_enc *enc, FILE *in, uint64_t size,
+							FILE *out)
+{
+	int in_fd = fileno(in);
+	int out_fd = fileno(out);
+	uint8_t *in_buf = malloc(IOV_SEGMENTS * IOV_SEGMENT_SIZE);
+	uint8_t *out_buf = malloc(IOV_SEGMENTS * IOV_OUT_SEGMENT_SIZE);
+
+	if (in_buf == NULL || out_buf == NULL) {
+		perror("Couldn't allocate segments");
+		exit(EXIT_FAILURE);
+	}
+
+	/* the headers must be written before the data, the input continues
+	 * where stdio stopped */
+	off_t in_pos = ftello(in);
+	if (fflush(out) != 0 || in_pos < 0 ||
+		lseek(in_fd, in_pos, SEEK_SET) != in_pos) {
+		perror("Couldn't switch to scatter-gather I/O");
+		exit(EXIT_FAILURE);
+	}
+
+	struct iovec in_iov[IOV_SEGMENTS], out_iov[IOV_SEGMENTS];
+	int in_cnt, out_cnt;
+	struct bit_writer writer;
+
+	split_segments(out_buf, IOV_OUT_SEGMENT_SIZE,
+				   IOV_SEGMENTS * IOV_OUT_SEGMENT_SIZE, out_iov, &out_cnt);
+	bit_writer_init_iov(&writer, out_iov, out_cnt);
+
+	while (size > 0) {
+		size_t len = IOV_SEGMENTS * IOV_SEGMENT_SIZE;
+		if (size < len)
+			len = size;
+
+		split_segments(in_buf, IOV_SEGMENT_SIZE, len, in_iov, &in_cnt);
+		read_segments(in_fd, in_iov, in_cnt);
+		split_segments(in_buf, IOV_SEGMENT_SIZE, len, in_iov, &in_cnt);
+
+		struct iovec *next = in_iov;
+		int next_cnt = in_cnt;
+		while (next_cnt > 0) {
+			size_t done;
+			if (!huff_encode_iov(enc, next, next_cnt, &writer, &done)) {
+				fprintf(stderr, "Input contains symbols without a code in the table\n");
+				exit(EXIT_FAILURE);
+			}
+
+			skip_segments(&next, &next_cnt, done);
+
+			/* the pending bits stay in the writer */
+			write_segments(out_fd, out_iov, bit_writer_iov_size(&writer));
+			split_segments(out_buf, IOV_OUT_SEGMENT_SIZE,
+						   IOV_SEGMENTS * IOV_OUT_SEGMENT_SIZE, out_iov,
+						   &out_cnt);
+			bit_writer_set_iov(&writer, out_iov, out_cnt);
+		}
+
+		size -= len;
+	}
+
+	bit_writer_align(&writer);
+	write_segments(out_fd, out_iov, bit_writer_iov_size(&writer));
+
+	/* the position of the stream is behind the data again */
+	fseeko(out, 0, SEEK_CUR);
+
+	free(in_buf);
+	free(out_buf);
+}
+
+/* the checkpoints are only known after encoding, so the seek table is
+ * written twice */
+static off_t write_skt(FILE *out, const struct huff_seek *seek, off_t pos)
+{
+	off_t end = ftello(out);
+	if (pos >= 0 && fseeko(out, pos, SEEK_SET) != 0) {
+		perror("Couldn't seek in output file");
+		exit(EXIT_FAILURE);
+	}
+
+	off_t start = ftello(out);
+	if (start < 0 || !huff_seek_write(out, seek)) {
+		fprintf(stderr, "Couldn't write seek table\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (pos >= 0 && fseeko(out, end, SEEK_SET) != 0) {
+		perror("Couldn't seek in output file");
+		exit(EXIT_FAILURE);
+	}
+
+	return start;
+}
+
+/* stuffed size of the entropy data of the following block */
+static void write_blk(FILE *out, uint64_t data_size)
+{
+	uint8_t header[12];
+	header[0] = 0xFF;
+	header[1] = JPG_BLK;
+	header[2] = 0;
+	header[3] = 10;
+
+	for (int i = 0; i < 8; i++)
+		header[4 + i] = (data_size >> (56 - 8 * i)) & 0xFF;
+
+	if (fwrite(header, sizeof(header), 1, out) != 1) {
+		fprintf(stderr, "Couldn't write header\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void write_crc(FILE *out, uint32_t crc)
+{
+	const uint8_t header[8] = { 0xFF, JPG_CRC, 0, 6, crc >> 24, crc >> 16,
+								crc >> 8, crc };
+	if (fwrite(header, sizeof(header), 1, out) != 1) {
+		fprintf(stderr, "Couldn't write header\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void write_xfm(FILE *out, enum huff_transform type)
+{
+	const uint8_t header[5] = { 0xFF, JPG_XFM, 0, 3, type };
+	if (fwrite(header, sizeof(header), 1, out) != 1) {
+		fprintf(stderr, "Couldn't write header\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/* one block with its own table: BLK, optional CRC and XFM, DHT, DNL and
+ * entropy data */
+static void write_block(FILE *out, const uint8_t block[], size_t block_size,
+						struct huff_stats *stats)
+{
+	/* the transform with the smallest estimated output is applied */
+	uint8_t *transformed = malloc(huff_transform_bound(block_size));
+	if (transformed == NULL) {
+		perror("Couldn't allocate block buffer");
+		exit(EXIT_FAILURE);
+	}
+
+	const uint8_t *data = block;
+	size_t size = block_size;
+	enum huff_transform type = huff_transform_select(block, block_size,
+													 transformed, &size);
+	if (type != HUFF_TRANSFORM_NONE)
+		data = transformed;
+	else
+		size = block_size;
+
+	uint64_t freq[256];
+	huff_get_freq(data, size, freq);
+
+	struct huff_enc enc = { .stats = stats };
+	struct huff_enc_info info;
+	struct huff_estimate estimate;
+
+	if (!huff_gen_enc(freq, &enc, &info) ||
+		!huff_estimate_enc(freq, &enc, &estimate)) {
+		fprintf(stderr, "Couldn't create encoder\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* every payload byte may be followed by a stuffed zero byte */
+	size_t bound = 2 * ((estimate.payload_bits + 7) / 8) + 2;
+	uint8_t *buffer = malloc(bound);
+	if (buffer == NULL) {
+		perror("Couldn't allocate block buffer");
+		exit(EXIT_FAILURE);
+	}
+
+	/* huff_encode sees the transformed data, the checksum is of the block */
+	uint32_t crc = 0;
+	if (block_crc && type == HUFF_TRANSFORM_NONE)
+		enc.crc = &crc;
+	else if (block_crc)
+		crc = huff_crc32c(0, block, block_size);
+
+	struct bit_writer writer;
+	bit_writer_init_mem(&writer, buffer, bound);
+	if (!huff_encode(&enc, size, data, &writer) || !bit_writer_align(&writer)) {
+		fprintf(stderr, "Couldn't encode block\n");
+		exit(EXIT_FAILURE);
+	}
+
+	size_t data_size = bit_writer_size(&writer);
+	write_blk(out, data_size);
+	if (block_crc)
+		write_crc(out, crc);
+	if (type != HUFF_TRANSFORM_NONE)
+		write_xfm(out, type);
+	write_dht(out, &enc, &info);
+	write_dnl(out, size);
+
+	if (fwrite(buffer, 1, data_size, out) != data_size) {
+		fprintf(stderr, "Couldn't write block\n");
+		exit(EXIT_FAILURE);
+	}
+
+	free(buffer);
+	free(transformed);
+	huff_enc_destroy(&enc);
+}
+
+/* the input is read in windows, a block is written once the next window
+ * starts a new one */
+static void encode_blocks(FILE *in, FILE *out, struct huff_stats *stats)
+{
+	/* the step is read behind the block before the split is known */
+	uint8_t *block = malloc(HUFF_SPLIT_MAX_BLOCK + HUFF_SPLIT_STEP);
+	struct huff_split *split = malloc(sizeof(*split));
+	if (block == NULL || split == NULL) {
+		perror("Couldn't allocate block buffer");
+		exit(EXIT_FAILURE);
+	}
+
+	huff_split_init(split);
+	size_t block_size = 0;
+	size_t len;
+	size_t carry;
+
+	while ((len = fread(&block[block_size], 1, HUFF_SPLIT_STEP, in)) > 0) {
+		block_size += len;
+
+		if (huff_split_add(split, &block[block_size - len], len, &carry)) {
+			write_block(out, block, block_size - carry, stats);
+			memmove(block, &block[block_size - carry], carry);
+			block_size = carry;
+		}
+	}
+
+	if (ferror(in)) {
+		fprintf(stderr, "Couldn't read input data\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (block_size > 0)
+		write_block(out, block, block_size, stats);
+
+	free(split);
+	free(block);
+
+	if (stats != NULL)
+		stats->out_bytes = ftello(out);
+}
+
+/* Every SIZE bytes of input are a message, which is flushed so it can be
+ * decoded before the next one arrives. The input can be a pipe, so the table
+ * is built from the first message, with a code for every symbol. */
+static void encode_stream(FILE *in, FILE *out, size_t msg_size,
+						  struct huff_stats *stats)
+{
+	uint8_t *msg = malloc(msg_size);
+	if (msg == NULL) {
+		perror("Couldn't allocate message buffer");
+		exit(EXIT_FAILURE);
+	}
+
+	size_t len = fread(msg, 1, msg_size, in);
+
+	uint64_t freq[256];
+	huff_get_freq(msg, len, freq);
+	for (int i = 0; i < 256; i++)
+		freq[i]++;
+
+	struct huff_enc enc = { .stats = stats };
+	struct huff_enc_info info;
+	struct huff_stream stream;
+
+	if (!huff_gen_enc(freq, &enc, &info)) {
+		fprintf(stderr, "Couldn't create encoder\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (!huff_stream_init(&stream, &enc, &info, out))
+		exit(EXIT_FAILURE);
+
+	while (len > 0) {
+		if (!huff_stream_write(&stream, msg, len) ||
+			!huff_stream_flush(&stream))
+			exit(EXIT_FAILURE);
+
+		len = fread(msg, 1, msg_size, in);
+	}
+
+	if (ferror(in)) {
+		fprintf(stderr, "Couldn't read input data\n");
+		exit(EXIT_FAILURE);
+	}
+
+	if (!huff_stream_close(&stream))
+		exit(EXIT_FAILURE);
+
+	huff_enc_destroy(&enc);
+	free(msg);
+
+	/* unknown for pipes */
+	off_t pos = ftello(out);
+	if (stats != NULL && pos > 0)
+		stats->out_bytes = pos;
+}
+
+/* The input is a sequence of 16 bit little endian samples, every sample is
+ * one symbol: WHT, DNL and entropy data. */
+static void encode_wide(FILE *in, FILE *out, struct huff_stats *stats)
+{
+	off_t size;
+	uint8_t *data = read_file(in, &size);
+	if (size == 0)
+		return;
+
+	if (data == NULL) {
+		perror("Couldn't read input data");
+		exit(EXIT_FAILURE);
+	}
+
+	if (size % 2 != 0) {
+		fprintf(stderr, "Input size must be a multiple of 2 bytes\n");
+		exit(EXIT_FAILURE);
+	}
+
+	size_t num_sym = size / 2;
+	uint16_t *samples = malloc(num_sym * sizeof(*samples));
+	if (samples == NULL) {
+		perror("Couldn't allocate samples");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t i = 0; i < num_sym; i++)
+		samples[i] = data[2 * i] | (data[2 * i + 1] << 8);
+	free(data);
+
+	struct huff_wide_freq freq;
+	struct huff_wide_enc enc = { .stats = stats };
+	if (!huff_wide_get_freq(samples, num_sym, &freq) ||
+		!huff_wide_gen_enc(&freq, &enc)) {
+		fprintf(stderr, "Couldn't create encoder\n");
 		exit(EXIT_FAILURE);
 	}
+	huff_wide_freq_destroy(&freq);
+
+	if (!huff_wide_write_wht(out, &enc))
+		exit(EXIT_FAILURE);
+	write_dnl(out, num_sym);
 
 	struct bit_writer *writer = bit_writer_create(out);
-	huff_encode(&enc, size, data, writer);
+	if (writer == NULL || !huff_wide_encode(&enc, num_sym, samples, writer)) {
+		fprintf(stderr, "Couldn't encode samples\n");
+		exit(EXIT_FAILURE);
+	}
 
 	bit_writer_destroy(writer);
+	huff_wide_enc_destroy(&enc);
+	free(samples);
+
+	if (stats != NULL)
+		stats->out_bytes = ftello(out);
+}
+
+void encode(FILE *in, FILE *out, const struct huff_table *table,
+			uint8_t num_lanes, uint32_t seek_interval, struct huff_stats *stats)
+{
+	off_t size = get_file_size(in);
+	if (size == 0)
+		return;
+
+	/* the lanes are built in memory, a plain stream is encoded in chunks */
+	uint8_t *data = NULL;
+	if (num_lanes > 0 && (data = read_file(in, &size)) == NULL) {
+		perror("Couldn't read input data");
+		exit(EXIT_FAILURE);
+	}
+
+	struct huff_enc enc = { .stats = stats };
+	struct huff_enc_info info;
+
+	if (table != NULL) {
+		huff_enc_from_table(table, &enc);
+	} else {
+		uint64_t freq[256];
+		if (data != NULL)
+			huff_get_freq(data, size, freq);
+		else
+			get_freq_file(in, freq);
+
+		if (data == NULL && fseeko(in, 0, SEEK_SET) != 0) {
+			perror("Couldn't rewind input file");
+			exit(EXIT_FAILURE);
+		}
+
+		if (!huff_gen_enc(freq, &enc, &info)) {
+			fprintf(stderr, "Couldn't create encoder\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	uint8_t *lanes = NULL;
+	size_t lanes_size = 0;
+
+	if (num_lanes > 0) {
+		size_t lane_size[HUFF_MAX_LANES];
+		lanes = encode_lanes(&enc, data, size, num_lanes, lane_size,
+							 &lanes_size);
+		write_ilv(out, num_lanes, lane_size);
+	}
+
+	struct huff_seek seek;
+	off_t seek_pos = -1;
+
+	if (seek_interval > 0) {
+		if (!huff_seek_init(&seek, seek_interval, size))
+			exit(EXIT_FAILURE);
+		seek_pos = write_skt(out, &seek, -1);
+	}
+
+	if (table != NULL)
+		write_dtr(out, table->id);
+	else
+		write_dht(out, &enc, &info);
+
+	write_dnl(out, size);
+
+	if (lanes != NULL) {
+		if (fwrite(lanes, 1, lanes_size, out) != lanes_size) {
+			fprintf(stderr, "Couldn't write lanes\n");
+			exit(EXIT_FAILURE);
+		}
+
+		free(lanes);
+	} else if (seek_pos >= 0) {
+		encode_file(&enc, in, size, out, &seek);
+	} else {
+		encode_file_iov(&enc, in, size, out);
+	}
+
+	if (seek_pos >= 0) {
+		write_skt(out, &seek, seek_pos);
+		huff_seek_destroy(&seek);
+	}
+
 	huff_enc_destroy(&enc);
 	free(data);
+
+	if (stats != NULL)
+		stats->out_bytes = ftello(out);
+}
+
+/* Multi file mode: files are cut into blocks of at most 8 MiB, which are
+ * encoded on the thread pool. Small files are batched into one task, so the
+ * pool isn't flooded with tiny tasks. The blocks are written in order by the
+ * main thread once a file is complete. Only a window of files is submitted
+ * at a time, so the encoded blocks waiting for the main thread don't grow
+ * with the whole input. */
+#define MULTI_BLOCK_SIZE (HUFF_SPLIT_MAX_BLOCK)
+#define MULTI_BATCH_SIZE (1024 * 1024)
+#define MULTI_BATCH_UNITS (256)
+#define MULTI_WINDOW_BLOCKS (4) /* input bytes in flight per thread */
+#define MULTI_WINDOW_FILES (1024)
+#define MULTI_SUFFIX ".huf"
+
+struct multi_file {
+	char *name;
+	uint64_t size;
+	size_t num_blocks;
+	char **blocks; /* BLK, DHT, DNL and entropy data of every block */
+	size_t *block_size;
+	size_t pending; /* blocks not encoded yet */
+};
+
+struct multi_unit {
+	struct multi_file *file;
+	size_t block;
+};
+
+struct multi_task {
+	size_t num_units;
+	struct multi_unit units[MULTI_BATCH_UNITS];
+};
+
+static pthread_mutex_t multi_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t multi_done = PTHREAD_COND_INITIALIZER;
+static struct huff_stats *multi_stats;
+
+static void encode_unit(const struct multi_unit *unit, uint8_t data[],
+						struct huff_stats *stats)
+{
+	struct multi_file *file = unit->file;
+	uint64_t offset = (uint64_t)unit->block * MULTI_BLOCK_SIZE;
+	size_t len = (file->size - offset < MULTI_BLOCK_SIZE) ?
+		file->size - offset : MULTI_BLOCK_SIZE;
+
+	FILE *in = fopen(file->name, "rb");
+	if (in == NULL || fseeko(in, offset, SEEK_SET) != 0 ||
+		fread(data, len, 1, in) != 1) {
+		fprintf(stderr, "Couldn't read %s\n", file->name);
+		exit(EXIT_FAILURE);
+	}
+	fclose(in);
+
+	FILE *mem = open_memstream(&file->blocks[unit->block],
+							   &file->block_size[unit->block]);
+	if (mem == NULL) {
+		perror("Couldn't allocate block");
+		exit(EXIT_FAILURE);
+	}
+
+	write_block(mem, data, len, stats);
+	fclose(mem);
+}
+
+static void encode_task(void *arg)
+{
+	struct multi_task *task = arg;
+	struct huff_stats stats;
+	memset(&stats, 0, sizeof(stats));
+
+	uint8_t *data = malloc(MULTI_BLOCK_SIZE);
+	if (data == NULL) {
+		perror("Couldn't allocate block buffer");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t i = 0; i < task->num_units; i++) {
+		encode_unit(&task->units[i], data,
+					(multi_stats != NULL) ? &stats : NULL);
+
+		pthread_mutex_lock(&multi_lock);
+		if (--task->units[i].file->pending == 0)
+			pthread_cond_broadcast(&multi_done);
+		pthread_mutex_unlock(&multi_lock);
+	}
+
+	if (multi_stats != NULL) {
+		pthread_mutex_lock(&multi_lock);
+		huff_stats_merge(multi_stats, &stats);
+		pthread_mutex_unlock(&multi_lock);
+	}
+
+	free(data);
+	free(task);
+}
+
+/* archive entry: size of the following blocks and the file name, names are
+ * stored relative like tar does */
+static void write_arc(FILE *out, const struct multi_file *file,
+					  uint64_t data_size)
+{
+	const char *name = file->name;
+	while (*name == '/')
+		name++;
+
+	size_t name_len = strlen(name);
+	if (name_len == 0 || name_len > UINT16_MAX - 10) {
+		fprintf(stderr, "Invalid file name: %s\n", file->name);
+		exit(EXIT_FAILURE);
+	}
+
+	uint8_t header[12];
+	header[0] = 0xFF;
+	header[1] = JPG_ARC;
+	header[2] = (name_len + 10) >> 8;
+	header[3] = (name_len + 10) & 0xFF;
+
+	for (int i = 0; i < 8; i++)
+		header[4 + i] = (data_size >> (56 - 8 * i)) & 0xFF;
+
+	if (fwrite(header, sizeof(header), 1, out) != 1 ||
+		fwrite(name, 1, name_len, out) != name_len) {
+		fprintf(stderr, "Couldn't write archive entry\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+/* an existing file is only replaced with --force */
+static FILE *open_output(const char *name)
+{
+	FILE *out = NULL;
+
+	if (force) {
+		out = fopen(name, "wb");
+	} else {
+		int fd = open(name, O_WRONLY | O_CREAT | O_EXCL, 0666);
+		if (fd != -1 && (out = fdopen(fd, "wb")) == NULL)
+			close(fd);
+	}
+
+	if (out == NULL) {
+		bool exists = (errno == EEXIST);
+		perror(name);
+		if (exists)
+			fprintf(stderr, "Use --force to replace existing files\n");
+		exit(EXIT_FAILURE);
+	}
+
+	return out;
+}
+
+/* archive NULL writes every file to FILE.huf, returns the written bytes */
+static uint64_t write_multi_file(struct multi_file *file, FILE *archive)
+{
+	pthread_mutex_lock(&multi_lock);
+	while (file->pending > 0)
+		pthread_cond_wait(&multi_done, &multi_lock);
+	pthread_mutex_unlock(&multi_lock);
+
+	uint64_t data_size = 0;
+	for (size_t i = 0; i < file->num_blocks; i++)
+		data_size += file->block_size[i];
+
+	FILE *out = archive;
+	if (archive != NULL) {
+		write_arc(archive, file, data_size);
+	} else {
+		char out_name[strlen(file->name) + sizeof(MULTI_SUFFIX)];
+		sprintf(out_name, "%s%s", file->name, MULTI_SUFFIX);
+		out = open_output(out_name);
+	}
+
+	for (size_t i = 0; i < file->num_blocks; i++) {
+		if (fwrite(file->blocks[i], 1, file->block_size[i], out) !=
+			file->block_size[i]) {
+			fprintf(stderr, "Couldn't write block\n");
+			exit(EXIT_FAILURE);
+		}
+
+		free(file->blocks[i]);
+	}
+
+	if (archive == NULL)
+		fclose(out);
+
+	free(file->blocks);
+	free(file->block_size);
+	return data_size;
+}
+
+static bool has_suffix(const char *name, const char *suffix)
+{
+	size_t len = strlen(name);
+	size_t suffix_len = strlen(suffix);
+
+	return len >= suffix_len && strcmp(name + len - suffix_len, suffix) == 0;
+}
+
+/* Skips the files the run writes itself: FILE.huf and the archive (exclude,
+ * NULL if there is none yet), so a second run doesn't encode them again. */
+static void collect_files(const char *path, const struct stat *exclude,
+						  char ***names, size_t *num_names)
+{
+	DIR *dir = opendir(path);
+	if (dir == NULL) {
+		perror(path);
+		exit(EXIT_FAILURE);
+	}
+
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL) {
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+
+		char *name = malloc(strlen(path) + strlen(entry->d_name) + 2);
+		if (name == NULL) {
+			perror("Couldn't allocate file name");
+			exit(EXIT_FAILURE);
+		}
+		sprintf(name, "%s/%s", path, entry->d_name);
+
+		struct stat buf;
+		if (lstat(name, &buf) != 0) {
+			perror(name);
+			exit(EXIT_FAILURE);
+		}
+
+		bool written = has_suffix(name, MULTI_SUFFIX) ||
+			(exclude != NULL && buf.st_dev == exclude->st_dev &&
+			 buf.st_ino == exclude->st_ino);
+
+		if (S_ISDIR(buf.st_mode)) {
+			collect_files(name, exclude, names, num_names);
+			free(name);
+		} else if (S_ISREG(buf.st_mode) && !written) {
+			char **tmp = realloc(*names, (*num_names + 1) * sizeof(*tmp));
+			if (tmp == NULL) {
+				perror("Couldn't allocate file list");
+				exit(EXIT_FAILURE);
+			}
+			*names = tmp;
+			(*names)[(*num_names)++] = name;
+		} else {
+			free(name); /* links, special files and outputs are skipped */
+		}
+	}
+
+	closedir(dir);
+}
+
+static int compare_names(const void *a, const void *b)
+{
+	return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* the blocks of a task must be submitted before the main thread waits for
+ * their file */
+static void submit_task(struct huff_pool *pool, struct multi_task **task,
+						size_t *task_bytes)
+{
+	if (*task != NULL && !huff_pool_submit(pool, encode_task, *task))
+		exit(EXIT_FAILURE);
+
+	*task = NULL;
+	*task_bytes = 0;
+}
+
+static void encode_multi(char *names[], size_t num_files, const char *archive_name,
+						 unsigned num_threads, struct huff_stats *stats)
+{
+	struct multi_file *files = calloc(num_files, sizeof(*files));
+	if (files == NULL) {
+		perror("Couldn't allocate file list");
+		exit(EXIT_FAILURE);
+	}
+
+	FILE *archive = NULL;
+	if (archive_name != NULL && (archive = fopen(archive_name, "wb")) == NULL) {
+		perror("Couldn't open archive");
+		exit(EXIT_FAILURE);
+	}
+
+	struct huff_pool *pool = huff_pool_create(num_threads);
+	if (pool == NULL)
+		exit(EXIT_FAILURE);
+
+	multi_stats = stats;
+	struct multi_task *task = NULL;
+	size_t task_bytes = 0;
+
+	/* files from written to i are in flight */
+	uint64_t window_size = (uint64_t)MULTI_WINDOW_BLOCKS * num_threads *
+		MULTI_BLOCK_SIZE;
+	uint64_t in_flight = 0;
+	uint64_t out_bytes = 0;
+	size_t written = 0;
+
+	for (size_t i = 0; i < num_files; i++) {
+		struct multi_file *file = &files[i];
+		struct stat buf;
+
+		if (stat(names[i], &buf) != 0 || !S_ISREG(buf.st_mode)) {
+			fprintf(stderr, "Not a regular file: %s\n", names[i]);
+			exit(EXIT_FAILURE);
+		}
+
+		file->name = names[i];
+		file->size = buf.st_size;
+
+		while (written < i && (i - written >= MULTI_WINDOW_FILES ||
+							   in_flight + file->size > window_size)) {
+			submit_task(pool, &task, &task_bytes);
+			out_bytes += write_multi_file(&files[written], archive);
+			in_flight -= files[written].size;
+			written++;
+		}
+
+		in_flight += file->size;
+		file->num_blocks = (file->size + MULTI_BLOCK_SIZE - 1) / MULTI_BLOCK_SIZE;
+		file->pending = file->num_blocks;
+		file->blocks = calloc(file->num_blocks + 1, sizeof(*file->blocks));
+		file->block_size = calloc(file->num_blocks + 1, sizeof(*file->block_size));
+		if (file->blocks == NULL || file->block_size == NULL) {
+			perror("Couldn't allocate block list");
+			exit(EXIT_FAILURE);
+		}
+
+		for (size_t j = 0; j < file->num_blocks; j++) {
+			if (task == NULL && (task = calloc(1, sizeof(*task))) == NULL) {
+				perror("Couldn't allocate task");
+				exit(EXIT_FAILURE);
+			}
+
+			task->units[task->num_units].file = file;
+			task->units[task->num_units].block = j;
+			task->num_units++;
+			task_bytes += (j + 1 < file->num_blocks) ? MULTI_BLOCK_SIZE :
+				file->size - j * MULTI_BLOCK_SIZE;
+
+			if (task_bytes >= MULTI_BATCH_SIZE ||
+				task->num_units == MULTI_BATCH_UNITS)
+				submit_task(pool, &task, &task_bytes);
+		}
+	}
+
+	submit_task(pool, &task, &task_bytes);
+
+	for (; written < num_files; written++)
+		out_bytes += write_multi_file(&files[written], archive);
+
+	huff_pool_wait(pool);
+	huff_pool_destroy(pool);
+
+	if (stats != NULL)
+		stats->out_bytes = out_bytes;
+
+	if (archive != NULL)
+		fclose(archive);
+
+	free(files);
+}
+
+/* build one table from all sample files and save it as dictionary */
+static void train(int argc, char *argv[])
+{
+	unsigned long id = 1;
+	const char *header_name = NULL;
+	int i = 2;
+
+	for (; i < argc - 1 && argv[i][0] == '-'; i += 2) {
+		if (strcmp(argv[i], "-i") == 0) {
+			char *end;
+			id = strtoul(argv[i + 1], &end, 10);
+			if (*end != '\0' || id == 0 || id > 255) {
+				fprintf(stderr, "Table id must be between 1 and 255\n");
+				exit(EXIT_FAILURE);
+			}
+		} else if (strcmp(argv[i], "-c") == 0) {
+			header_name = argv[i + 1];
+		} else {
+			usage();
+		}
+	}
+
+	if (argc - i < 2)
+		usage();
+
+	const char *dict_name = argv[i];
+
+	uint64_t freq[256] = { 0 };
+	for (i++; i < argc; i++) {
+		FILE *in = fopen(argv[i], "rb");
+		if (in == NULL) {
+			perror("Couldn't open input file");
+			exit(EXIT_FAILURE);
+		}
+
+		uint64_t file_freq[256];
+		get_freq_file(in, file_freq);
+		fclose(in);
+
+		for (int j = 0; j < 256; j++)
+			freq[j] += file_freq[j];
+	}
+
+	struct huff_table table;
+	if (!huff_table_train(freq, id, &table)) {
+		fprintf(stderr, "Couldn't create table\n");
+		exit(EXIT_FAILURE);
+	}
+
+	FILE *out = fopen(dict_name, "wb");
+	if (out == NULL) {
+		perror("Couldn't open dictionary file");
+		exit(EXIT_FAILURE);
+	}
+
+	if (!huff_table_write(out, &table))
+		exit(EXIT_FAILURE);
+	fclose(out);
+
+	if (header_name != NULL) {
+		out = fopen(header_name, "w");
+		if (out == NULL) {
+			perror("Couldn't open header file");
+			exit(EXIT_FAILURE);
+		}
+
+		char name[32];
+		snprintf(name, sizeof(name), "huff_table_%lu", id);
+		if (!huff_table_write_c(out, name, &table))
+			exit(EXIT_FAILURE);
+		fclose(out);
+	}
+
+	huff_table_destroy(&table);
 }
 
 int main(int argc, char *argv[])
@@ -140,26 +1209,220 @@ int main(int argc, char *argv[])
 
 	if (argc > 1)
 		prog_name = argv[0];
-	
-	if (argc != 3)
+
+	if (argc > 1 && strcmp(argv[1], "--train") == 0) {
+		train(argc, argv);
+		return 0;
+	}
+
+	struct huff_table table;
+	struct huff_table *dict = NULL;
+	unsigned long num_lanes = 0;
+	unsigned long seek_interval = 0;
+	bool blocks = false;
+	bool wide = false;
+	unsigned long msg_size = 0;
+	bool multi = false;
+	const char *dir_name = NULL;
+	const char *archive_name = NULL;
+	long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	int arg = 1;
+
+	while (arg < argc && argv[arg][0] == '-') {
+		if (strcmp(argv[arg], "--stats") == 0) {
+			stats_format = STATS_TEXT;
+			arg++;
+		} else if (strcmp(argv[arg], "--stats-json") == 0) {
+			stats_format = STATS_JSON;
+			arg++;
+		} else if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc &&
+				   dict == NULL) {
+			FILE *dict_file = fopen(argv[arg + 1], "rb");
+			if (dict_file == NULL) {
+				perror("Couldn't open dictionary file");
+				return EXIT_FAILURE;
+			}
+
+			if (!huff_table_read(dict_file, &table))
+				return EXIT_FAILURE;
+
+			fclose(dict_file);
+			dict = &table;
+			arg += 2;
+		} else if (strcmp(argv[arg], "-l") == 0 && arg + 1 < argc) {
+			char *end;
+			num_lanes = strtoul(argv[arg + 1], &end, 10);
+			if (*end != '\0' || num_lanes == 0 || num_lanes > HUFF_MAX_LANES) {
+				fprintf(stderr, "Number of lanes must be between 1 and %d\n",
+						HUFF_MAX_LANES);
+				return EXIT_FAILURE;
+			}
+			arg += 2;
+		} else if (strcmp(argv[arg], "--crc") == 0) {
+			block_crc = true;
+			arg++;
+		} else if (strcmp(argv[arg], "-b") == 0) {
+			blocks = true;
+			arg++;
+		} else if (strcmp(argv[arg], "-w") == 0) {
+			wide = true;
+			arg++;
+		} else if (strcmp(argv[arg], "-m") == 0) {
+			multi = true;
+			arg++;
+		} else if (strcmp(argv[arg], "--force") == 0) {
+			force = true;
+			arg++;
+		} else if (strcmp(argv[arg], "-r") == 0 && arg + 1 < argc) {
+			dir_name = argv[arg + 1];
+			arg += 2;
+		} else if (strcmp(argv[arg], "-a") == 0 && arg + 1 < argc) {
+			archive_name = argv[arg + 1];
+			arg += 2;
+		} else if (strcmp(argv[arg], "-j") == 0 && arg + 1 < argc) {
+			char *end;
+			num_threads = strtol(argv[arg + 1], &end, 10);
+			if (*end != '\0' || num_threads < 1 ||
+				num_threads > HUFF_POOL_MAX_THREADS) {
+				fprintf(stderr, "Number of threads must be between 1 and %d\n",
+						HUFF_POOL_MAX_THREADS);
+				return EXIT_FAILURE;
+			}
+			arg += 2;
+		} else if (strcmp(argv[arg], "-f") == 0 && arg + 1 < argc) {
+			char *end;
+			msg_size = strtoul(argv[arg + 1], &end, 10);
+			if (*end != '\0' || msg_size == 0 || msg_size > HUFF_SPLIT_MAX_BLOCK) {
+				fprintf(stderr, "Message size must be between 1 and %d\n",
+						HUFF_SPLIT_MAX_BLOCK);
+				return EXIT_FAILURE;
+			}
+			arg += 2;
+		} else if (strcmp(argv[arg], "-s") == 0 && arg + 1 < argc) {
+			char *end;
+			seek_interval = strtoul(argv[arg + 1], &end, 10);
+			if (*end != '\0' || seek_interval == 0 ||
+				seek_interval > UINT32_MAX) {
+				fprintf(stderr, "Seek interval must be between 1 and %lu\n",
+						(unsigned long)UINT32_MAX);
+				return EXIT_FAILURE;
+			}
+			arg += 2;
+		} else {
+			usage();
+		}
+	}
+
+	struct huff_stats stats;
+	memset(&stats, 0, sizeof(stats));
+	struct huff_stats *stats_ptr = (stats_format != STATS_NONE) ? &stats : NULL;
+
+	if (multi || dir_name != NULL) {
+		if ((multi && (argc == arg || dir_name != NULL)) ||
+			(!multi && argc != arg))
+			usage();
+
+		if (blocks || wide || msg_size > 0 || num_lanes > 0 ||
+			seek_interval > 0 || dict != NULL) {
+			fprintf(stderr, "Multiple files can't be combined with -b, -f, -l, "
+					"-s, -t or -w\n");
+			return EXIT_FAILURE;
+		}
+
+		char **names = argv + arg;
+		size_t num_files = argc - arg;
+		if (dir_name != NULL) {
+			struct stat archive;
+			bool exclude = archive_name != NULL && stat(archive_name, &archive) == 0;
+
+			names = NULL;
+			collect_files(dir_name, exclude ? &archive : NULL, &names, &num_files);
+			qsort(names, num_files, sizeof(*names), compare_names);
+		}
+
+		if (num_threads < 1)
+			num_threads = 1;
+		else if (num_threads > HUFF_POOL_MAX_THREADS)
+			num_threads = HUFF_POOL_MAX_THREADS;
+
+		encode_multi(names, num_files, archive_name, num_threads, stats_ptr);
+
+		if (dir_name != NULL) {
+			for (size_t i = 0; i < num_files; i++)
+				free(names[i]);
+			free(names);
+		}
+
+		if (stats_format == STATS_TEXT)
+			huff_stats_print(stderr, &stats);
+		else if (stats_format == STATS_JSON)
+			huff_stats_print_json(stderr, &stats);
+
+		return 0;
+	}
+
+	if (argc - arg != 2 || archive_name != NULL)
 		usage();
+
+	if (block_crc && !blocks) {
+		fprintf(stderr, "Checksums need blocks (-b, -m or -r)\n");
+		return EXIT_FAILURE;
+	}
+
+	if (num_lanes > 0 && seek_interval > 0) {
+		fprintf(stderr, "A seek table can't be used with lanes\n");
+		return EXIT_FAILURE;
+	}
+
+	if (blocks && (num_lanes > 0 || seek_interval > 0 || dict != NULL)) {
+		fprintf(stderr, "Blocks can't be combined with -l, -s or -t\n");
+		return EXIT_FAILURE;
+	}
+
+	if (msg_size > 0 && (blocks || num_lanes > 0 || seek_interval > 0 ||
+						 dict != NULL)) {
+		fprintf(stderr, "Streams can't be combined with -b, -l, -s or -t\n");
+		return EXIT_FAILURE;
+	}
+
+	if (wide && (blocks || msg_size > 0 || num_lanes > 0 || seek_interval > 0 ||
+				 dict != NULL)) {
+		fprintf(stderr, "16 bit symbols can't be combined with -b, -f, -l, -s "
+				"or -t\n");
+		return EXIT_FAILURE;
+	}
 	
-	FILE *in = fopen(argv[1], "rb");
+	FILE *in = fopen(argv[arg], "rb");
 	if (in == NULL) {
 		perror("Couldn't open input file");
 		return EXIT_FAILURE;
 	}
 
-	FILE *out = fopen(argv[2], "wb");
+	FILE *out = fopen(argv[arg + 1], "wb");
 	if (out == NULL) {
 		perror("Couldn't open output file");
 		return EXIT_FAILURE;
 	}
 
-	encode(in, out);
+	if (blocks)
+		encode_blocks(in, out, stats_ptr);
+	else if (msg_size > 0)
+		encode_stream(in, out, msg_size, stats_ptr);
+	else if (wide)
+		encode_wide(in, out, stats_ptr);
+	else
+		encode(in, out, dict, num_lanes, seek_interval, stats_ptr);
 
 	fclose(in);
 	fclose(out);
 
+	if (stats_format == STATS_TEXT)
+		huff_stats_print(stderr, &stats);
+	else if (stats_format == STATS_JSON)
+		huff_stats_print_json(stderr, &stats);
+
+	if (dict != NULL)
+		huff_table_destroy(dict);
+
 	return 0;
 }
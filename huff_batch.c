@@ -0,0 +1,113 @@
+/*
+ * @file huff_batch.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ */
+
+#include <assert.h>
+#include "bit_reader.h"
+#include "bit_writer.h"
+#include "huff_batch.h"
+
+/* Every record is byte aligned. A code has at most 16 bits and every byte can
+ * be stuffed, so a record takes at most 4 bytes per symbol plus the stuffed
+ * padding byte. */
+size_t huff_batch_bound(const struct huff_record records[restrict],
+						size_t num_records)
+{
+	assert(records != NULL || num_records == 0);
+
+	size_t size = 0;
+	for (size_t i = 0; i < num_records; i++)
+		size += 4 * records[i].len + 2;
+
+	return size;
+}
+
+bool huff_batch_gen_enc(const struct huff_record records[restrict],
+						size_t num_records, struct huff_enc * restrict encoder,
+						struct huff_enc_info * restrict info)
+{
+	assert(records != NULL || num_records == 0);
+
+	uint64_t freq[256] = { 0 };
+
+	for (size_t i = 0; i < num_records; i++) {
+		const uint8_t *data = records[i].data;
+
+		for (size_t j = 0; j < records[i].len; j++)
+			freq[data[j]]++;
+	}
+
+	return huff_gen_enc(freq, encoder, info);
+}
+
+bool huff_batch_gen_dec(const struct huff_enc * restrict encoder,
+						struct huff_dec * restrict decoder)
+{
+	assert(encoder != NULL);
+	assert(decoder != NULL);
+
+	uint8_t codes_per_len[16];
+	uint8_t symbols[256];
+	huff_enc_export(encoder, codes_per_len, symbols);
+
+	return huff_gen_dec(codes_per_len, symbols, decoder);
+}
+
+/* offsets has num_records + 1 entries, record i is stored in
+ * out[offsets[i]] to out[offsets[i + 1] - 1] */
+bool huff_encode_batch(const struct huff_enc * restrict encoder,
+					   const struct huff_record records[restrict],
+					   size_t num_records, uint8_t out[restrict],
+					   size_t out_size, size_t offsets[restrict])
+{
+	assert(encoder != NULL);
+	assert(records != NULL || num_records == 0);
+	assert(offsets != NULL);
+
+	struct bit_writer writer;
+	bit_writer_init_mem(&writer, out, out_size);
+
+	offsets[0] = 0;
+
+	for (size_t i = 0; i < num_records; i++) {
+		if (!huff_encode(encoder, records[i].len, records[i].data, &writer) ||
+			!bit_writer_align(&writer))
+			return false;
+
+		offsets[i + 1] = bit_writer_size(&writer);
+	}
+
+	return true;
+}
+
+/* decodes all records back to back into out; lengths holds the number of
+ * symbols of every record */
+bool huff_decode_batch(const struct huff_dec * restrict decoder,
+					   const uint8_t in[restrict],
+					   const size_t offsets[restrict],
+					   const size_t lengths[restrict], size_t num_records,
+					   uint8_t out[restrict])
+{
+	assert(decoder != NULL);
+	assert(offsets != NULL);
+	assert(lengths != NULL || num_records == 0);
+
+	struct bit_reader reader;
+
+	for (size_t i = 0; i < num_records; i++) {
+		assert(offsets[i] <= offsets[i + 1]);
+
+		bit_reader_init_mem(&reader, &in[offsets[i]],
+							offsets[i + 1] - offsets[i]);
+
+		if (!huff_decode(decoder, lengths[i], &reader, out))
+			return false;
+
+		out += lengths[i];
+	}
+
+	return true;
+}
+
@@ -0,0 +1,41 @@
+/*
+ * @file huff_batch.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Encoding and decoding of many small records with one shared table.
+ */
+
+#ifndef HUFF_BATCH_H
+#define HUFF_BATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "huff_enc.h"
+#include "huff_dec.h"
+
+struct huff_record {
+	const uint8_t *data;
+	size_t len;
+};
+
+size_t huff_batch_bound(const struct huff_record records[restrict],
+						size_t num_records);
+bool huff_batch_gen_enc(const struct huff_record records[restrict],
+						size_t num_records, struct huff_enc * restrict encoder,
+						struct huff_enc_info * restrict info);
+/* decoder for the records of encoder, without a DHT segment */
+bool huff_batch_gen_dec(const struct huff_enc * restrict encoder,
+						struct huff_dec * restrict decoder);
+bool huff_encode_batch(const struct huff_enc * restrict encoder,
+					   const struct huff_record records[restrict],
+					   size_t num_records, uint8_t out[restrict],
+					   size_t out_size, size_t offsets[restrict]);
+bool huff_decode_batch(const struct huff_dec * restrict decoder,
+					   const uint8_t in[restrict],
+					   const size_t offsets[restrict],
+					   const size_t lengths[restrict], size_t num_records,
+					   uint8_t out[restrict]);
+
+#endif
+
@@ -0,0 +1,214 @@
+/*
+ * @file huff_cache.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "huff_cache.h"
+
+struct cache_entry {
+	uint64_t hash; /* 0 = unused */
+	uint8_t  code_len[16];
+	uint8_t  symbols[256];
+
+	struct huff_dec dec;
+	uint32_t refs;
+	uint64_t last_use;
+};
+
+static struct cache_entry cache[HUFF_CACHE_SIZE];
+static uint64_t cache_tick;
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint16_t num_symbols(const uint8_t code_len[16])
+{
+	uint16_t num_sym = 0;
+	for (int i = 0; i < 16; i++)
+		num_sym += code_len[i];
+
+	return num_sym;
+}
+
+/* FNV-1a over the length counts and the symbols, never 0 */
+static uint64_t header_hash(const uint8_t code_len[16],
+							const uint8_t symbols[], uint16_t num_sym)
+{
+	uint64_t hash = 0xcbf29ce484222325;
+
+	for (int i = 0; i < 16; i++)
+		hash = (hash ^ code_len[i]) * 0x100000001b3;
+
+	for (uint16_t i = 0; i < num_sym; i++)
+		hash = (hash ^ symbols[i]) * 0x100000001b3;
+
+	return (hash != 0) ? hash : 1;
+}
+
+static struct cache_entry *find(uint64_t hash, const uint8_t code_len[16],
+								const uint8_t symbols[], uint16_t num_sym)
+{
+	for (int i = 0; i < HUFF_CACHE_SIZE; i++) {
+		struct cache_entry *entry = &cache[i];
+
+		if (entry->hash == hash &&
+			memcmp(entry->code_len, code_len, 16) == 0 &&
+			memcmp(entry->symbols, symbols, num_sym) == 0)
+			return entry;
+	}
+
+	return NULL;
+}
+
+/* unused slot or least recently used unreferenced table, NULL if all are in
+ * use */
+static struct cache_entry *find_free(void)
+{
+	struct cache_entry *victim = NULL;
+
+	for (int i = 0; i < HUFF_CACHE_SIZE; i++) {
+		struct cache_entry *entry = &cache[i];
+
+		if (entry->hash == 0)
+			return entry;
+
+		if (entry->refs == 0 &&
+			(victim == NULL || entry->last_use < victim->last_use))
+			victim = entry;
+	}
+
+	if (victim != NULL) {
+		huff_destroy(&victim->dec);
+		victim->hash = 0;
+	}
+
+	return victim;
+}
+
+static void use_entry(struct cache_entry *entry, struct huff_dec *decoder)
+{
+	entry->refs++;
+	entry->last_use = ++cache_tick;
+
+	huff_dec_set_table(decoder, entry->dec.min_bits, entry->dec.max_bits,
+					   entry->dec.entries);
+
+	if (decoder->stats != NULL)
+		huff_stats_table(decoder->stats, num_symbols(entry->code_len),
+						 entry->dec.min_bits, entry->dec.max_bits);
+}
+
+bool huff_cache_get_dec(const uint8_t code_len[restrict 16],
+						const uint8_t symbols[restrict],
+						struct huff_dec * restrict decoder)
+{
+	assert(code_len != NULL);
+	assert(symbols  != NULL);
+	assert(decoder  != NULL);
+
+	uint16_t num_sym = num_symbols(code_len);
+	if (num_sym == 0 || num_sym > 256) {
+		fprintf(stderr, "Invalid number of symbols\n");
+		return false;
+	}
+
+	/* canonical decoders are small, they aren't worth sharing */
+	if (decoder->mode == HUFF_DEC_CANONICAL)
+		return huff_gen_dec(code_len, symbols, decoder);
+
+	uint64_t hash = header_hash(code_len, symbols, num_sym);
+
+	pthread_mutex_lock(&cache_lock);
+
+	struct cache_entry *entry = find(hash, code_len, symbols, num_sym);
+	if (entry != NULL) {
+		use_entry(entry, decoder);
+		pthread_mutex_unlock(&cache_lock);
+		return true;
+	}
+
+	pthread_mutex_unlock(&cache_lock);
+
+	/* build outside of the lock */
+	struct huff_dec dec = { .stats = decoder->stats,
+							.untransform = decoder->untransform,
+							.crc = decoder->crc };
+	if (!huff_gen_dec(code_len, symbols, &dec))
+		return false;
+
+	pthread_mutex_lock(&cache_lock);
+
+	/* another thread may have built the same table in the meantime */
+	entry = find(hash, code_len, symbols, num_sym);
+	if (entry == NULL)
+		entry = find_free();
+
+	if (entry == NULL) {
+		/* cache full of tables in use, the decoder owns its table */
+		pthread_mutex_unlock(&cache_lock);
+		*decoder = dec;
+		return true;
+	}
+
+	if (entry->hash == 0) {
+		entry->hash = hash;
+		memcpy(entry->code_len, code_len, 16);
+		memcpy(entry->symbols, symbols, num_sym);
+		entry->dec = dec;
+		entry->dec.stats = NULL;
+		entry->refs = 0;
+	} else {
+		huff_destroy(&dec);
+	}
+
+	use_entry(entry, decoder);
+	pthread_mutex_unlock(&cache_lock);
+	return true;
+}
+
+void huff_cache_release(struct huff_dec *decoder)
+{
+	assert(decoder != NULL);
+
+	if (!decoder->shared) {
+		huff_destroy(decoder);
+		return;
+	}
+
+	pthread_mutex_lock(&cache_lock);
+
+	for (int i = 0; i < HUFF_CACHE_SIZE; i++) {
+		struct cache_entry *entry = &cache[i];
+
+		if (entry->hash != 0 && entry->dec.entries == decoder->entries) {
+			assert(entry->refs > 0);
+			entry->refs--;
+			break;
+		}
+	}
+
+	pthread_mutex_unlock(&cache_lock);
+	decoder->entries = NULL;
+}
+
+/* frees all unreferenced tables */
+void huff_cache_clear(void)
+{
+	pthread_mutex_lock(&cache_lock);
+
+	for (int i = 0; i < HUFF_CACHE_SIZE; i++) {
+		struct cache_entry *entry = &cache[i];
+
+		if (entry->hash != 0 && entry->refs == 0) {
+			huff_destroy(&entry->dec);
+			entry->hash = 0;
+		}
+	}
+
+	pthread_mutex_unlock(&cache_lock);
+}
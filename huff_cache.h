@@ -0,0 +1,28 @@
+/*
+ * @file huff_cache.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Process wide cache of decode tables.
+ */
+
+#ifndef HUFF_CACHE_H
+#define HUFF_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "huff_dec.h"
+
+#define HUFF_CACHE_SIZE (32)
+
+/* Decoders for the same DHT header share one decode table. The table is
+ * reference counted and the least recently used unreferenced table is
+ * evicted when the cache is full. If every cached table is in use, the
+ * decoder gets its own table. All functions are thread safe. */
+bool huff_cache_get_dec(const uint8_t code_len[restrict 16],
+						const uint8_t symbols[restrict],
+						struct huff_dec * restrict decoder);
+/* use instead of huff_destroy for decoders from huff_cache_get_dec */
+void huff_cache_release(struct huff_dec *decoder);
+void huff_cache_clear(void);
+
+#endif
@@ -0,0 +1,18 @@
+/*
+ * @file huff_crc.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief CRC32C checksum of the uncompressed data.
+ */
+
+#ifndef HUFF_CRC_H
+#define HUFF_CRC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* CRC32C (Castagnoli) as used by iSCSI and SSE4.2. crc is the checksum of the
+ * data before, 0 for the first chunk. */
+uint32_t huff_crc32c(uint32_t crc, const uint8_t data[], size_t size);
+
+#endif
@@ -5,17 +5,182 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include "bit_reader.h"
 #include "huff_dec.h"
+#include "huff_crc.h"
+
+#define DECODE_CHUNK_SIZE (4096)
+
+/* After a refill at least 56 bits are in the bit buffer. Every symbol needs a
+ * lookahead of max_bits and consumes at most max_bits, so 56 / max_bits
+ * symbols can be decoded between two refills. */
+#define SYMS_PER_REFILL(max_bits) (56 / (max_bits))
+
+/* Decode loop with a compile time max_bits. The main loop runs while the
+ * reader has enough slack for an unchecked refill, its inner loop has a
+ * constant trip count and gets unrolled. The last bytes of the input are
+ * decoded by the checked tail loop. Decoding fails if a code used the zero
+ * bits appended after the end of the data (truncated input). */
+#define DECODE_KERNEL(max_bits)                                               \
+static bool decode_##max_bits(const struct huff_dec * restrict decoder,       \
+							  size_t num_sym,                                 \
+							  struct bit_reader * restrict reader,            \
+							  uint8_t out_buf[restrict])                      \
+{                                                                             \
+	const uint16_t *table = decoder->entries;                                 \
+	size_t i = 0;                                                             \
+                                                                              \
+	while (num_sym - i >= SYMS_PER_REFILL(max_bits) &&                        \
+		   bit_reader_has_slack(reader)) {                                    \
+		bit_reader_refill_fast(reader);                                       \
+                                                                              \
+		for (int k = 0; k < SYMS_PER_REFILL(max_bits); k++) {                 \
+			uint16_t entry = table[bit_reader_peek(reader, max_bits)];        \
+			out_buf[i + k] = entry >> 8;                                      \
+			bit_reader_consume(reader, entry & 0xFF);                         \
+		}                                                                     \
+                                                                              \
+		i += SYMS_PER_REFILL(max_bits);                                       \
+	}                                                                         \
+                                                                              \
+	for (; i < num_sym; i++) {                                                \
+		bit_reader_refill(reader);                                            \
+		uint16_t entry = table[bit_reader_peek(reader, max_bits)];            \
+		out_buf[i] = entry >> 8;                                              \
+		bit_reader_consume(reader, entry & 0xFF);                             \
+                                                                              \
+		if (bit_reader_overrun(reader))                                       \
+			return false;                                                     \
+	}                                                                         \
+                                                                              \
+	return !bit_reader_overrun(reader);                                       \
+}
+
+DECODE_KERNEL(1)
+DECODE_KERNEL(2)
+DECODE_KERNEL(3)
+DECODE_KERNEL(4)
+DECODE_KERNEL(5)
+DECODE_KERNEL(6)
+DECODE_KERNEL(7)
+DECODE_KERNEL(8)
+DECODE_KERNEL(9)
+DECODE_KERNEL(10)
+DECODE_KERNEL(11)
+DECODE_KERNEL(12)
+DECODE_KERNEL(13)
+DECODE_KERNEL(14)
+DECODE_KERNEL(15)
+DECODE_KERNEL(16)
+
+static inline uint8_t decode_canon(const struct huff_canon * restrict canon,
+								   uint8_t min_bits,
+								   struct bit_reader * restrict reader)
+{
+	uint32_t bits = bit_reader_peek(reader, 16);
+	uint8_t len = min_bits;
+
+	while (bits >= canon->limit[len])
+		len++;
+
+	bit_reader_consume(reader, len);
+	return canon->symbols[canon->offset[len] + (bits >> (16 - len))];
+}
+
+/* Same structure as the table kernels, but the code length is found by
+ * comparing the next 16 bits with the limit of every length. Only the top
+ * max_bits of the peeked bits decide the length, so the number of symbols
+ * per refill is the same. */
+static bool decode_canonical(const struct huff_dec * restrict decoder,
+							 size_t num_sym,
+							 struct bit_reader * restrict reader,
+							 uint8_t out_buf[restrict])
+{
+	const struct huff_canon *canon = decoder->canon;
+	const uint8_t min_bits = decoder->min_bits;
+	const size_t per_refill = SYMS_PER_REFILL(decoder->max_bits);
+	size_t i = 0;
+
+	while (num_sym - i >= per_refill && bit_reader_has_slack(reader)) {
+		bit_reader_refill_fast(reader);
+
+		for (size_t k = 0; k < per_refill; k++)
+			out_buf[i + k] = decode_canon(canon, min_bits, reader);
+
+		i += per_refill;
+	}
+
+	for (; i < num_sym; i++) {
+		bit_reader_refill(reader);
+		out_buf[i] = decode_canon(canon, min_bits, reader);
+
+		if (bit_reader_overrun(reader))
+			return false;
+	}
+
+	return !bit_reader_overrun(reader);
+}
+
+static bool gen_canonical(const uint8_t code_len[16], const uint8_t symbols[],
+						  struct huff_dec *decoder)
+{
+	struct huff_canon *canon = malloc(sizeof(*canon));
+	if (canon == NULL) {
+		perror("Couldn't allocate memory for canonical decoder");
+		return false;
+	}
+
+	uint32_t code = 0;
+	int32_t index = 0;
+
+	canon->limit[0] = 0;
+	canon->offset[0] = 0;
+
+	for (int len = 1; len <= 16; len++) {
+		uint8_t count = code_len[len - 1];
+
+		canon->offset[len] = index - (int32_t)code;
+		memcpy(&canon->symbols[index], &symbols[index], count);
+
+		code += count;
+		index += count;
+		canon->limit[len] = code << (16 - len);
+		code <<= 1;
+	}
+
+	/* complete code: the last limit covers all 16 bit values */
+	if (canon->limit[decoder->max_bits] != (1u << 16)) {
+		fprintf(stderr, "Invalid decode header. Code is not complete\n");
+		free(canon);
+		return false;
+	}
+
+	decoder->canon = canon;
+	decoder->entries = NULL;
+	decoder->decode = decode_canonical;
+	return true;
+}
+
+static const huff_decode_fn decode_kernels[16] = {
+	decode_1,  decode_2,  decode_3,  decode_4,
+	decode_5,  decode_6,  decode_7,  decode_8,
+	decode_9,  decode_10, decode_11, decode_12,
+	decode_13, decode_14, decode_15, decode_16
+};
 
-bool huff_gen_dec(uint8_t code_len[restrict 16], uint8_t symbols[restrict],
+bool huff_gen_dec(const uint8_t code_len[restrict 16],
+				  const uint8_t symbols[restrict],
 				  struct huff_dec * restrict decoder)
 {
 	assert(code_len != NULL);
 	assert(symbols  != NULL);
 	assert(decoder  != NULL);
 
+	struct huff_timer timer;
+	huff_timer_start(&timer, decoder->stats);
+
 	uint16_t num_sym = 0;
 	uint8_t max_bits = 0;
 	uint8_t min_bits = 0;
@@ -23,10 +188,10 @@ bool huff_gen_dec(uint8_t code_len[restrict 16], uint8_t symbols[restrict],
 	for (int i = 0; i < 16; i++) {
 		num_sym += code_len[i];
 		max_bits = (code_len[i] != 0) ? i + 1 : max_bits;
-		min_bits = (min_bits == 0) ? i + 1 : min_bits;
+		min_bits = (min_bits == 0 && code_len[i] != 0) ? i + 1 : min_bits;
 	}
 
-	if (num_sym > 256 && num_sym == 0) {
+	if (num_sym > 256 || num_sym == 0) {
 		fprintf(stderr, "Invalid number of symbols\n");
 		return false;
 	}
@@ -40,9 +205,26 @@ bool huff_gen_dec(uint8_t code_len[restrict 16], uint8_t symbols[restrict],
 
 	decoder->max_bits = max_bits;
 	decoder->min_bits = min_bits;
-	decoder->entries  = malloc(sizeof(uint16_t) * num_entries);
+	decoder->decode   = decode_kernels[max_bits - 1];
+	decoder->shared   = false;
+	decoder->canon    = NULL;
+
+	if (decoder->mode == HUFF_DEC_CANONICAL) {
+		if (!gen_canonical(code_len, symbols, decoder))
+			return false;
+
+		if (decoder->stats != NULL) {
+			huff_stats_table(decoder->stats, num_sym, min_bits, max_bits);
+			decoder->stats->dec_table_size = sizeof(struct huff_canon);
+			huff_timer_stop(&timer, decoder->stats, HUFF_STAGE_GEN_DEC);
+		}
 
-	if(decoder->entries == NULL) {
+		return true;
+	}
+
+	/* one more entry so that vector gathers can read 32 bits at every index */
+	uint16_t *entries = malloc(sizeof(uint16_t) * (num_entries + 1));
+	if(entries == NULL) {
 		perror("Couldn't allocate memory for decode table\n");
 		return false;
 	}
@@ -58,10 +240,16 @@ bool huff_gen_dec(uint8_t code_len[restrict 16], uint8_t symbols[restrict],
 			uint8_t symbol = symbols[sym_index];
 			sym_index++;
 
+			/* the kraft sum of a corrupt header can exceed 1 */
+			if (index + times > num_entries) {
+				fprintf(stderr, "Invalid decode header. Too many codes\n");
+				free(entries);
+				return false;
+			}
+
 			for (uint16_t t = 0; t < times; t++) {
-				decoder->entries[index] = (symbol << 8) | (i + 1);
+				entries[index] = (symbol << 8) | (i + 1);
 				index++;
-				assert(index <= num_entries);
 			}
 		}
 	}
@@ -71,10 +259,20 @@ bool huff_gen_dec(uint8_t code_len[restrict 16], uint8_t symbols[restrict],
 	 * missing. */
 	if (index != num_entries) {
 		fprintf(stderr, "Invalid decode header. Missing entries in decode table\n");
-		free(decoder->entries);
+		free(entries);
 		return false;
 	}
 
+	entries[num_entries] = 0;
+	decoder->entries = entries;
+
+	struct huff_stats *stats = decoder->stats;
+	if (stats != NULL) {
+		huff_stats_table(stats, num_sym, min_bits, max_bits);
+		stats->dec_table_size = sizeof(uint16_t) * num_entries;
+		huff_timer_stop(&timer, stats, HUFF_STAGE_GEN_DEC);
+	}
+
 	return true;
 }
 
@@ -88,43 +286,42 @@ bool huff_decode(const struct huff_dec * restrict decoder, size_t num_sym,
 
 	if (num_sym == 0)
 		return true;
-	
-	/* FIXME this only works when decoding starts at byte boundary. Add functions
-	   to push back bits in bit_reader and extend decoding to decode at any bit
-	   position. */
-	
-	uint16_t code;
-	uint8_t max_bits = decoder->max_bits;
-	const uint16_t mask = (1 << max_bits) - 1;
-	uint16_t *table = decoder->entries;
-
-	/* FIXME special case with less than max_bits in the data stream. */
-	if (!bit_reader_next_bits(reader, &code, max_bits)) {
-		fprintf(stderr, "Error while reading input\n");
+
+	struct huff_timer timer;
+	huff_timer_start(&timer, decoder->stats);
+
+	if (!decoder->decode(decoder, num_sym, reader, out_buf)) {
+		fprintf(stderr, "Unexpected end of input data\n");
 		return false;
 	}
 
-	for (size_t i = 0; i < num_sym; i++) {
-		code &= mask;
-		uint16_t entry = table[code];
-		uint8_t symbol = (entry >> 8) & 0xFF;
-		uint8_t length = entry & 0xFF;
+	if (decoder->stats != NULL) {
+		decoder->stats->num_sym += num_sym;
+		decoder->stats->out_bytes += num_sym;
+		huff_timer_stop(&timer, decoder->stats, HUFF_STAGE_DECODE);
+	}
 
-		assert(length != 0);
-		assert(length <= max_bits);
+	return true;
+}
 
-		out_buf[i] = symbol;
+bool huff_decode_iov(const struct huff_dec * restrict decoder,
+					 struct bit_reader * restrict reader,
+					 const struct iovec out[restrict], int out_cnt)
+{
+	assert(decoder != NULL);
+	assert(decoder->untransform == NULL);
+	assert(out != NULL || out_cnt == 0);
 
-		if (i == num_sym - 1)
-			break;
+	for (int i = 0; i < out_cnt; i++) {
+		if (out[i].iov_len == 0)
+			continue;
 
-		uint16_t tmp = 0;
-		if (!bit_reader_next_bits(reader, &tmp, length)) {
-			fprintf(stderr, "Error while reading input\n");
+		if (!huff_decode(decoder, out[i].iov_len, reader, out[i].iov_base))
 			return false;
-		}
-		
-		code = (code << length) | tmp;
+
+		if (decoder->crc != NULL)
+			*decoder->crc = huff_crc32c(*decoder->crc, out[i].iov_base,
+										out[i].iov_len);
 	}
 
 	return true;
@@ -135,63 +332,75 @@ bool huff_decode_file(const struct huff_dec * restrict decoder, size_t num_sym,
 {
 	assert(decoder != NULL);
 	assert(reader  != NULL);
-	assert(out     != NULL);
 
-	if (num_sym == 0)
-		return true;
-	
-	/* FIXME this only works when decoding starts at byte boundary. Add functions
-	   to push back bits in bit_reader and extend decoding to decode at any bit
-	   position. */
-	
-	uint32_t code;
-	uint8_t max_bits = decoder->max_bits;
-	const uint16_t mask = (1 << max_bits) - 1;
-	uint16_t *table = decoder->entries;
-
-	/* FIXME special case with less than max_bits in the data stream. */
-	/* FIXME handle EOF correctly */
-	uint16_t code16;
-	bit_reader_next_bits(reader, &code16, max_bits);
-	code = code16;
-	/*
-		fprintf(stderr, "Error while reading input\n");
-		return false;
-	}*/
-
-	for (size_t i = 0; i < num_sym; i++) {
-		code &= mask;
-		uint16_t entry = table[code];
-		uint8_t symbol = (entry >> 8) & 0xFF;
-		uint8_t length = entry & 0xFF;
-
-		assert(length != 0);
-		assert(length <= max_bits);
-		
-		if (fwrite(&symbol, 1, 1, out) != 1) {
-			fprintf(stderr, "Error while writing output symbols\n");
+	uint8_t buffer[DECODE_CHUNK_SIZE];
+
+	struct huff_timer timer;
+	huff_timer_start(&timer, decoder->stats);
+
+	uint64_t total = num_sym;
+	while (num_sym > 0) {
+		size_t len = (num_sym < sizeof(buffer)) ? num_sym : sizeof(buffer);
+
+		if (!decoder->decode(decoder, len, reader, buffer)) {
+			fprintf(stderr, "Unexpected end of input data\n");
 			return false;
 		}
-		
-		if (i == num_sym - 1)
-			break;
 
-		uint16_t tmp = 0;
-		bit_reader_next_bits(reader, &tmp, length);/*
-			fprintf(stderr, "Error while reading input\n");
-			return false;
-		}*/
-		
-		/* FIXME this can overflow when code is uint16_t */
-		code = (code << length) | tmp;
+		if (decoder->untransform != NULL) {
+			if (!huff_untransform_write(decoder->untransform, buffer, len,
+										decoder->crc, out))
+				return false;
+		} else {
+			if (decoder->crc != NULL)
+				*decoder->crc = huff_crc32c(*decoder->crc, buffer, len);
+
+			if (out != NULL && fwrite(buffer, 1, len, out) != len) {
+				fprintf(stderr, "Error while writing output symbols\n");
+				return false;
+			}
+		}
+
+		num_sym -= len;
+	}
+
+	if (decoder->stats != NULL) {
+		decoder->stats->num_sym += total;
+		decoder->stats->out_bytes += total;
+		huff_timer_stop(&timer, decoder->stats, HUFF_STAGE_DECODE);
 	}
 
 	return true;
 }
 
+void huff_dec_set_table(struct huff_dec * restrict decoder, uint8_t min_bits,
+						uint8_t max_bits, const uint16_t entries[restrict])
+{
+	assert(decoder != NULL);
+	assert(entries != NULL);
+	assert(0 < max_bits && max_bits <= 16);
+
+	decoder->max_bits = max_bits;
+	decoder->min_bits = min_bits;
+	decoder->mode     = HUFF_DEC_TABLE;
+	decoder->entries  = entries;
+	decoder->canon    = NULL;
+	decoder->shared   = true;
+	decoder->decode   = decode_kernels[max_bits - 1];
+
+	if (decoder->stats != NULL) {
+		huff_stats_table(decoder->stats, 0, min_bits, max_bits);
+		decoder->stats->dec_table_size = sizeof(uint16_t) << max_bits;
+	}
+}
+
 void huff_destroy(struct huff_dec *dec)
 {
 	assert(dec != NULL);
-	free(dec->entries);
+
+	if (!dec->shared) {
+		free((void *)dec->entries);
+		free((void *)dec->canon);
+	}
 }
 
@@ -11,23 +11,76 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <sys/uio.h>
 #include "bit_reader.h"
+#include "huff_stats.h"
+#include "huff_transform.h"
+
+struct huff_dec;
+
+typedef bool (*huff_decode_fn)(const struct huff_dec * restrict decoder,
+							   size_t num_sym,
+							   struct bit_reader * restrict reader,
+							   uint8_t out_buf[restrict]);
+
+enum huff_dec_mode {
+	HUFF_DEC_TABLE,    /* lookup table with 2^max_bits entries, fastest */
+	HUFF_DEC_CANONICAL /* only the canonical code, a few hundred bytes */
+};
+
+/* Canonical decoding: limit[len] is the first code longer than len, left
+ * aligned to 16 bits. The symbol of code c with length len is
+ * symbols[offset[len] + c]. */
+struct huff_canon {
+	uint32_t limit[17];
+	int32_t  offset[17];
+	uint8_t  symbols[256];
+};
 
 struct huff_dec {
 	uint8_t max_bits; /* num_entries = 1 << num_bits; */
 	uint8_t min_bits;
 
-	/* high byte: symbol; low byte: num_bits; invalid code if num_bits = 0 */
-	uint16_t *entries;
+	/* set by the caller before huff_gen_dec, 0 is HUFF_DEC_TABLE */
+	enum huff_dec_mode mode;
+
+	/* high byte: symbol; low byte: num_bits; invalid code if num_bits = 0
+	 * followed by one zero entry for 32-bit gathers */
+	const uint16_t *entries;
+	const struct huff_canon *canon; /* instead of entries in canonical mode */
+	bool shared; /* entries isn't owned by the decoder, e.g. static tables */
+
+	/* decode loop specialized for max_bits, selected by huff_gen_dec */
+	huff_decode_fn decode;
+
+	/* optional, set by the caller (NULL to disable) before huff_gen_dec */
+	struct huff_stats *stats;
+
+	/* optional, huff_decode_file applies the inverse transform to every
+	 * decoded chunk before it is written */
+	struct huff_untransform *untransform;
+
+	/* optional, huff_decode_file updates the CRC32C of the output */
+	uint32_t *crc;
 };
 
-bool huff_gen_dec(uint8_t code_len[restrict 16], uint8_t symbols[restrict],
+bool huff_gen_dec(const uint8_t code_len[restrict 16],
+				  const uint8_t symbols[restrict],
 				  struct huff_dec * restrict decoder);
+/* out may be NULL to only check the data, e.g. with crc */
 bool huff_decode_file(const struct huff_dec * restrict decoder, size_t num_sym,
 					  struct bit_reader * restrict reader, FILE *out);
 bool huff_decode(const struct huff_dec * restrict decoder, size_t num_sym,
 				 struct bit_reader * restrict reader, 
 				 uint8_t out_buf[restrict]);
+/* Decodes as many symbols as fit into the segments, the reader can read from
+ * segments too (bit_reader_init_iov). The crc is updated, data with a
+ * transform isn't supported. */
+bool huff_decode_iov(const struct huff_dec * restrict decoder,
+					 struct bit_reader * restrict reader,
+					 const struct iovec out[restrict], int out_cnt);
+void huff_dec_set_table(struct huff_dec * restrict decoder, uint8_t min_bits,
+						uint8_t max_bits, const uint16_t entries[restrict]);
 void huff_destroy(struct huff_dec *dec);
 
 #endif
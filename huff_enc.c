@@ -5,40 +5,131 @@
  */
 
 #include <stdlib.h>
+#include <math.h>
 #include <assert.h>
+#include "huff_format.h"
 #include "huff_enc.h"
+#include "huff_crc.h"
+
+/* the checksum of a chunk is computed while it is in the cache */
+#define ENCODE_CRC_CHUNK (4096)
 
 struct node {
 	struct node *left;
 	struct node *right;
 	struct huff_code *code;
-	uint32_t count;
+	uint64_t count;
 };
 
 void huff_get_freq(const uint8_t data[restrict], size_t size, 
-					   uint32_t freq[restrict 256])
+					   uint64_t freq[restrict 256])
 {
-	if (size == 0)
-		return;
-	
 	for (int i = 0; i < 256; i++)
 		freq[i] = 0;
 
+	huff_add_freq(data, size, freq);
+}
+
+void huff_add_freq(const uint8_t data[restrict], size_t size,
+				   uint64_t freq[restrict 256])
+{
 	for (size_t i = 0; i < size; i++) {
 		uint8_t symbol = data[i];
 		freq[symbol]++;
 	}
 }
 
-static bool gen_code_lengths(uint16_t num_sym, const uint32_t freq[restrict],
+void huff_get_freq_iov(const struct iovec iov[restrict], int iovcnt,
+					   uint64_t freq[restrict 256])
+{
+	for (int i = 0; i < 256; i++)
+		freq[i] = 0;
+
+	huff_add_freq_iov(iov, iovcnt, freq);
+}
+
+void huff_add_freq_iov(const struct iovec iov[restrict], int iovcnt,
+					   uint64_t freq[restrict 256])
+{
+	assert(iov != NULL || iovcnt == 0);
+
+	for (int i = 0; i < iovcnt; i++)
+		huff_add_freq(iov[i].iov_base, iov[i].iov_len, freq);
+}
+
+static bool gen_code_lengths(uint16_t num_sym, const uint64_t freq[restrict],
 							 struct huff_code codes[restrict]);
 static void gen_canonical_codes(uint16_t num_codes, 
 								struct huff_code codes[restrict], 
 								struct huff_enc_info * restrict info);
-static bool limit_length(uint16_t num_codes, struct huff_code codes[restrict],
-						 uint8_t limit);
+static uint32_t limit_length(uint16_t num_codes,
+							 struct huff_code codes[restrict], uint8_t limit);
+static void split_full_length(uint16_t num_codes,
+							  struct huff_code codes[restrict],
+							  const uint64_t freq[restrict 256]);
+
+/* The node counts are sums of frequencies and must not overflow. If the sum
+ * of all frequencies doesn't fit in 64 bits, they are halved until it does.
+ * Used symbols keep a frequency of at least 1. Returns false if nothing was
+ * scaled. */
+static bool scale_freq(const uint64_t freq[restrict 256],
+					   uint64_t scaled[restrict 256])
+{
+	int shift = 0;
+
+	for (;;) {
+		uint64_t total = 0;
+		bool overflow = false;
 
-bool huff_gen_enc(const uint32_t freq[restrict 256],
+		for (int i = 0; i < 256 && !overflow; i++) {
+			uint64_t f = freq[i] >> shift;
+			if (f == 0 && freq[i] != 0)
+				f = 1;
+
+			overflow = f > UINT64_MAX - total;
+			total += f;
+		}
+
+		if (!overflow)
+			break;
+
+		shift++;
+	}
+
+	if (shift == 0)
+		return false;
+
+	for (int i = 0; i < 256; i++) {
+		scaled[i] = freq[i] >> shift;
+		if (scaled[i] == 0 && freq[i] != 0)
+			scaled[i] = 1;
+	}
+
+	return true;
+}
+
+/* order-0 entropy in bits per symbol, total is the number of symbols */
+static double entropy(const uint64_t freq[restrict 256],
+					  double * restrict total)
+{
+	/* in double, the sum of 64 bit counts can overflow */
+	*total = 0.0;
+	for (int i = 0; i < 256; i++)
+		*total += freq[i];
+
+	double sum = 0.0;
+	for (int i = 0; i < 256; i++) {
+		if (freq[i] == 0)
+			continue;
+
+		double p = freq[i] / *total;
+		sum -= p * log2(p);
+	}
+
+	return sum;
+}
+
+bool huff_gen_enc(const uint64_t freq[restrict 256],
 				  struct huff_enc * restrict encoder, 
 				  struct huff_enc_info * restrict info)
 {
@@ -46,6 +137,9 @@ bool huff_gen_enc(const uint32_t freq[restrict 256],
 	assert(encoder != NULL);
 	assert(info    != NULL);
 
+	struct huff_timer timer;
+	huff_timer_start(&timer, encoder->stats);
+
 	uint16_t num_sym = 0;
 
 	for (int i = 0; i < 256; i++) {
@@ -58,23 +152,61 @@ bool huff_gen_enc(const uint32_t freq[restrict 256],
 		return false;
 	}
 
+	/* one symbol needs a complete code too, so a second one is added */
+	const uint64_t *orig_freq = freq;
+	uint64_t padded[256];
+	if (num_sym == 1) {
+		for (int i = 0; i < 256; i++)
+			padded[i] = freq[i];
+
+		for (int i = 0; i < 256; i++) {
+			if (freq[i] != 0)
+				padded[(i + 1) & 0xFF] = 1;
+		}
+
+		freq = padded;
+		num_sym = 2;
+	}
+
 	struct huff_code *codes = malloc(num_sym * sizeof(*codes));
 	if (codes == NULL) {
 		perror("Couldn't allocate code table");
 		return false;
 	}
 
+	uint64_t scaled[256];
+	if (scale_freq(freq, scaled))
+		freq = scaled;
+
 	/* generate huffman code lengths */
 	gen_code_lengths(num_sym, freq, codes);
-	limit_length(num_sym, codes, 16);
+	uint32_t adjusted = limit_length(num_sym, codes, 16);
+	split_full_length(num_sym, codes, freq);
 
 	/* generate canonical huffman codes */
 	gen_canonical_codes(num_sym, codes, info);
 
+	for (int i = 0; i < 256; i++)
+		encoder->lookup[i] = 0;
+
+	for (uint16_t i = 0; i < num_sym; i++)
+		encoder->lookup[codes[i].symbol] = (codes[i].code << 8) | codes[i].code_len;
+
 	encoder->num_codes = num_sym;
 	encoder->codes = codes;
 	info->num_codes = num_sym;
 
+	struct huff_stats *stats = encoder->stats;
+	if (stats != NULL) {
+		double total;
+		double bits = entropy(orig_freq, &total);
+
+		huff_stats_table(stats, num_sym, info->min_bits, info->max_bits);
+		huff_stats_entropy(stats, bits, total);
+		stats->limit_adjust += adjusted;
+		huff_timer_stop(&timer, stats, HUFF_STAGE_GEN_ENC);
+	}
+
 	return true;
 }
 
@@ -83,30 +215,210 @@ void huff_enc_destroy(struct huff_enc *encoder)
 	free(encoder->codes);
 }
 
+uint16_t huff_enc_export(const struct huff_enc * restrict encoder,
+						 uint8_t codes_per_len[restrict 16],
+						 uint8_t symbols[restrict 256])
+{
+	assert(encoder       != NULL);
+	assert(codes_per_len != NULL);
+	assert(symbols       != NULL);
+
+	const uint32_t *lookup = encoder->lookup;
+
+	for (int i = 0; i < 16; i++)
+		codes_per_len[i] = 0;
+
+	for (int s = 0; s < 256; s++) {
+		uint8_t code_len = lookup[s] & 0xFF;
+		if (code_len != 0)
+			codes_per_len[code_len - 1]++;
+	}
+
+	/* canonical codes: the symbols of a length are in the order of their
+	 * codes, which start at first */
+	uint32_t first[16];
+	uint16_t index[16];
+	uint32_t code = 0;
+	uint16_t num_codes = 0;
+	for (int i = 0; i < 16; i++) {
+		first[i] = code;
+		index[i] = num_codes;
+		num_codes += codes_per_len[i];
+		code = (code + codes_per_len[i]) << 1;
+	}
+
+	for (int s = 0; s < 256; s++) {
+		uint8_t code_len = lookup[s] & 0xFF;
+		if (code_len != 0)
+			symbols[index[code_len - 1] + (lookup[s] >> 8) -
+					first[code_len - 1]] = s;
+	}
+
+	return num_codes;
+}
+
+/* DHT segment of a frame (table id 0) */
+bool huff_enc_write_dht(FILE *out, const struct huff_enc * restrict encoder,
+						const struct huff_enc_info * restrict info)
+{
+	assert(out     != NULL);
+	assert(encoder != NULL);
+	assert(info    != NULL);
+
+	uint8_t header[21];
+	header[0] = 0xFF;
+	header[1] = JPG_DHT;
+
+	uint16_t header_length = 19 + info->num_codes;
+	header[2] = header_length >> 8;
+	header[3] = header_length & 0xFF;
+	
+	header[4] = 0;
+
+	for (int i = 0; i < 16; i++) {
+		header[5 + i] = info->codes_per_len[i];
+	}
+	
+	if (fwrite(header, sizeof(header), 1, out) != 1) {
+		fprintf(stderr, "Couldn't write header\n");
+		return false;
+	}
+
+	uint8_t codes_per_len[16];
+	uint8_t symbols[256];
+	uint16_t num_codes = huff_enc_export(encoder, codes_per_len, symbols);
+	assert(num_codes == info->num_codes);
+
+	if (fwrite(symbols, num_codes, 1, out) != 1) {
+		fprintf(stderr, "Couldn't write header\n");
+		return false;
+	}
+
+	return true;
+}
+
+/* Encodes until the output is full, num_done symbols were consumed: their
+ * bits are written or pending in the writer. Returns false if a symbol has
+ * no code. */
+static bool encode_symbols(const struct huff_enc * restrict encoder,
+						   size_t num_sym, const uint8_t in_data[restrict],
+						   struct bit_writer * restrict writer,
+						   size_t * restrict num_done,
+						   uint64_t * restrict payload_bits)
+{
+	*num_done = 0;
+
+	/* bits left pending by a full output, less than 48 */
+	if (writer->num_bits >= 32 && !bit_writer_flush_bits(writer))
+		return true;
+
+	const uint32_t *lookup = encoder->lookup;
+	uint64_t bits = 0;
+
+	/* without a checksum the input is one chunk */
+	size_t chunk = (encoder->crc != NULL) ? ENCODE_CRC_CHUNK : num_sym;
+	for (size_t start = 0; start < num_sym; start += chunk) {
+		size_t end = (num_sym - start < chunk) ? num_sym : start + chunk;
+		bool full = false;
+
+		size_t i;
+		for (i = start; i < end; i++) {
+			uint32_t entry = lookup[in_data[i]];
+			uint16_t code = entry >> 8;
+			uint8_t code_len = entry & 0xFF;
+
+			/* symbol has no code in this table */
+			if (code_len == 0)
+				return false;
+
+			assert(code_len <= 16);
+			bits += code_len;
+
+			/* the bits of the symbol are pending even if the output is full */
+			if (!bit_writer_next_bits(writer, code, code_len)) {
+				full = true;
+				i++;
+				break;
+			}
+		}
+
+		if (encoder->crc != NULL)
+			*encoder->crc = huff_crc32c(*encoder->crc, &in_data[start],
+										i - start);
+
+		*num_done = i;
+		if (full)
+			break;
+	}
+
+	*payload_bits += bits;
+	return true;
+}
+
+static void update_stats(const struct huff_enc *encoder,
+						 const struct huff_timer *timer, size_t num_sym,
+						 uint64_t payload_bits, uint64_t stuffed)
+{
+	struct huff_stats *stats = encoder->stats;
+	if (stats != NULL) {
+		stats->num_sym += num_sym;
+		stats->in_bytes += num_sym;
+		stats->payload_bits += payload_bits;
+		stats->stuffed_bytes += stuffed;
+		huff_timer_stop(timer, stats, HUFF_STAGE_ENCODE);
+	}
+}
+
 bool huff_encode(const struct huff_enc * restrict encoder, size_t num_sym,
 				 const uint8_t in_data[restrict], 
 				 struct bit_writer * restrict writer)
 {
-	struct huff_code *codes = encoder->codes;
-	for (size_t i = 0; i < num_sym; i++) {
-		uint8_t symbol = in_data[i];
-		uint16_t code = 0;
-		uint8_t code_len = 0;
-
-		for (uint16_t j = 0; j < encoder->num_codes; j++) {
-			if (symbol != codes[j].symbol)
-				continue;
+	struct huff_timer timer;
+	huff_timer_start(&timer, encoder->stats);
 
-			code = codes[j].code;
-			code_len = codes[j].code_len;
-			break;
-		}
+	uint64_t stuffed = writer->num_stuffed;
+	uint64_t payload_bits = 0;
+	size_t done;
 
-		assert(0 < code_len && code_len <= 16);
+	if (!encode_symbols(encoder, num_sym, in_data, writer, &done,
+						&payload_bits))
+		return false;
+
+	update_stats(encoder, &timer, done, payload_bits,
+				 writer->num_stuffed - stuffed);
+	return done == num_sym;
+}
 
-		bit_writer_next_bits(writer, code, code_len);
+bool huff_encode_iov(const struct huff_enc * restrict encoder,
+					 const struct iovec in[restrict], int in_cnt,
+					 struct bit_writer * restrict writer,
+					 size_t * restrict num_done)
+{
+	assert(in != NULL || in_cnt == 0);
+	assert(num_done != NULL);
+
+	struct huff_timer timer;
+	huff_timer_start(&timer, encoder->stats);
+
+	uint64_t stuffed = writer->num_stuffed;
+	uint64_t payload_bits = 0;
+	*num_done = 0;
+
+	for (int i = 0; i < in_cnt; i++) {
+		size_t done;
+		bool ok = encode_symbols(encoder, in[i].iov_len, in[i].iov_base,
+								 writer, &done, &payload_bits);
+
+		*num_done += done;
+		if (!ok)
+			return false;
+
+		if (done < in[i].iov_len)
+			break;
 	}
 
+	update_stats(encoder, &timer, *num_done, payload_bits,
+				 writer->num_stuffed - stuffed);
 	return true;
 }
 
@@ -122,7 +434,7 @@ static void get_min_nodes(uint16_t n, const struct node nodes[restrict],
 	uint16_t index1 = 0;
 	uint16_t index2 = 0;
 
-	uint32_t count1 = nodes[0].count;
+	uint64_t count1 = nodes[0].count;
 	for (uint16_t i = 1; i < n; i++) {
 		if (count1 > nodes[i].count) {
 			count1 = nodes[i].count;
@@ -130,7 +442,7 @@ static void get_min_nodes(uint16_t n, const struct node nodes[restrict],
 		}
 	}
 	
-	uint32_t count2;
+	uint64_t count2;
 	if (index1 == 0) {
 		count2 = nodes[1].count;
 		index2 = 1;
@@ -171,7 +483,7 @@ static void set_len(const struct node *node, uint8_t depth)
 	}
 }
 
-static bool gen_code_lengths(uint16_t num_sym, const uint32_t freq[restrict],
+static bool gen_code_lengths(uint16_t num_sym, const uint64_t freq[restrict],
 							 struct huff_code codes[restrict])
 {
 	assert(0 < num_sym && num_sym <= 256);
@@ -180,7 +492,7 @@ static bool gen_code_lengths(uint16_t num_sym, const uint32_t freq[restrict],
 
 	struct node *nodes = malloc((2 * num_sym - 1) * sizeof(struct node));
 	size_t node_index = 0;
-	uint32_t freq_sum = 0;
+	uint64_t freq_sum = 0;
 	
 	for (int i = 0; i < 256; i++) {
 		if (freq[i] == 0)
@@ -254,8 +566,9 @@ static int len_cmp(const void *left, const void *right)
 		((const struct huff_code *)right)->code_len;
 }
 
-static bool limit_length(uint16_t num_codes, struct huff_code codes[restrict],
-						 uint8_t limit)
+/* returns the number of changed code lengths */
+static uint32_t limit_length(uint16_t num_codes,
+							 struct huff_code codes[restrict], uint8_t limit)
 {
 	assert(num_codes > 0);
 	assert(codes != NULL);
@@ -267,10 +580,13 @@ static bool limit_length(uint16_t num_codes, struct huff_code codes[restrict],
 	const uint32_t n = 1 << limit;
 
 	uint32_t kraft_sum = 0;
+	uint32_t adjusted = 0;
 
 	for (uint16_t i = 0; i < num_codes; i++) {
-		if (codes[i].code_len > limit)
+		if (codes[i].code_len > limit) {
 			codes[i].code_len = limit;
+			adjusted++;
+		}
 		kraft_sum += n >> codes[i].code_len;
 	}
 
@@ -285,6 +601,7 @@ static bool limit_length(uint16_t num_codes, struct huff_code codes[restrict],
 			
 			codes[index].code_len++;
 			kraft_sum -= n >> codes[index].code_len;
+			adjusted++;
 		}
 	}
 
@@ -304,10 +621,49 @@ static bool limit_length(uint16_t num_codes, struct huff_code codes[restrict],
 			kraft_sum += n >> codes[i].code_len;
 			kraft_diff -= n >> codes[i].code_len;
 			codes[i].code_len--;
+			adjusted++;
 		}
 	}
 
-	return true;
+	return adjusted;
+}
+
+/* The header stores the number of codes per length in one byte. With all 256
+ * symbols at length 8 that count overflows, so the most frequent symbol gets
+ * length 7 and the two least frequent get length 9. The kraft sum stays 1. */
+static void split_full_length(uint16_t num_codes,
+							  struct huff_code codes[restrict],
+							  const uint64_t freq[restrict 256])
+{
+	if (num_codes != 256)
+		return;
+
+	for (uint16_t i = 0; i < num_codes; i++) {
+		if (codes[i].code_len != 8)
+			return;
+	}
+
+	uint16_t max_index = 0;
+	for (uint16_t i = 1; i < num_codes; i++) {
+		if (freq[codes[i].symbol] > freq[codes[max_index].symbol])
+			max_index = i;
+	}
+
+	codes[max_index].code_len = 7;
+
+	for (int k = 0; k < 2; k++) {
+		uint16_t min_index = (max_index == 0) ? 1 : 0;
+		for (uint16_t i = 0; i < num_codes; i++) {
+			if (i == max_index || codes[i].code_len != 8)
+				continue;
+
+			if (freq[codes[i].symbol] < freq[codes[min_index].symbol] ||
+				codes[min_index].code_len != 8)
+				min_index = i;
+		}
+
+		codes[min_index].code_len = 9;
+	}
 }
 
 static void gen_canonical_codes(uint16_t num_codes, 
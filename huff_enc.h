@@ -11,7 +11,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <sys/uio.h>
 #include "bit_writer.h"
+#include "huff_stats.h"
 
 struct huff_code {
 	uint16_t code;
@@ -22,6 +24,15 @@ struct huff_code {
 struct huff_enc {
 	struct huff_code *codes;
 	uint16_t  num_codes;
+
+	/* indexed by symbol: code << 8 | code_len; code_len = 0 if unused */
+	uint32_t  lookup[256];
+
+	/* optional, set by the caller (NULL to disable) before huff_gen_enc */
+	struct huff_stats *stats;
+
+	/* optional, huff_encode updates the CRC32C of its input */
+	uint32_t *crc;
 };
 
 struct huff_enc_info {
@@ -32,14 +43,39 @@ struct huff_enc_info {
 };
 
 void huff_get_freq(const uint8_t data[restrict], size_t size, 
-				   uint32_t freq[restrict 256]);
-bool huff_gen_enc(const uint32_t freq[restrict 256],
+				   uint64_t freq[restrict 256]);
+/* adds the symbols of data to freq, for inputs read in chunks */
+void huff_add_freq(const uint8_t data[restrict], size_t size,
+				   uint64_t freq[restrict 256]);
+/* the same for data in segments */
+void huff_get_freq_iov(const struct iovec iov[restrict], int iovcnt,
+					   uint64_t freq[restrict 256]);
+void huff_add_freq_iov(const struct iovec iov[restrict], int iovcnt,
+					   uint64_t freq[restrict 256]);
+bool huff_gen_enc(const uint64_t freq[restrict 256],
 				  struct huff_enc * restrict encoder, 
 				  struct huff_enc_info * restrict info);
 void huff_enc_destroy(struct huff_enc *encoder);
+/* The table as in a DHT segment, the input of huff_gen_dec: the number of
+ * codes per length and the symbols ordered by code. Works for encoders of
+ * huff_enc_from_table too. Returns the number of codes. */
+uint16_t huff_enc_export(const struct huff_enc * restrict encoder,
+						 uint8_t codes_per_len[restrict 16],
+						 uint8_t symbols[restrict 256]);
+bool huff_enc_write_dht(FILE *out, const struct huff_enc * restrict encoder,
+						const struct huff_enc_info * restrict info);
 bool huff_encode(const struct huff_enc * restrict encoder, size_t num_sym,
 				 const uint8_t in_data[restrict], 
 				 struct bit_writer * restrict writer);
+/* Encodes the segments one after the other, the writer can write to
+ * segments too (bit_writer_init_iov). Stops on a symbol boundary when the
+ * output is full, num_done is the number of symbols consumed. The encoding
+ * continues with the next symbol after bit_writer_set_iov. Returns false if
+ * a symbol has no code. */
+bool huff_encode_iov(const struct huff_enc * restrict encoder,
+					 const struct iovec in[restrict], int in_cnt,
+					 struct bit_writer * restrict writer,
+					 size_t * restrict num_done);
 
 #endif
 
@@ -0,0 +1,189 @@
+/*
+ * @file huff_estimate.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ */
+
+#include <math.h>
+#include <assert.h>
+#include "huff_estimate.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+/* DHT segment without symbols, DTR segment and DNL segment */
+#define DHT_BASE_BYTES (2 + 19)
+#define DTR_BYTES      (5)
+#define DNL_BYTES      (12)
+
+static uint64_t dot_scalar(const uint64_t a[restrict 256],
+						   const uint8_t b[restrict 256])
+{
+	uint64_t sum = 0;
+	for (int i = 0; i < 256; i++)
+		sum += a[i] * b[i];
+
+	return sum;
+}
+
+#ifdef HAVE_AVX2
+/* 4 products per step, the 64 bit counts are multiplied in two 32 bit
+ * halves */
+__attribute__((target("avx2")))
+static uint64_t dot_avx2(const uint64_t a[restrict 256],
+						 const uint8_t b[restrict 256])
+{
+	__m256i sum = _mm256_setzero_si256();
+
+	for (int i = 0; i < 256; i += 4) {
+		__m256i va = _mm256_loadu_si256((const __m256i *)&a[i]);
+		__m128i vb8 = _mm_cvtsi32_si128(b[i] | (b[i + 1] << 8) |
+										(b[i + 2] << 16) |
+										((uint32_t)b[i + 3] << 24));
+		__m256i vb = _mm256_cvtepu8_epi64(vb8);
+
+		__m256i lo = _mm256_mul_epu32(va, vb);
+		__m256i hi = _mm256_mul_epu32(_mm256_srli_epi64(va, 32), vb);
+		sum = _mm256_add_epi64(sum, lo);
+		sum = _mm256_add_epi64(sum, _mm256_slli_epi64(hi, 32));
+	}
+
+	uint64_t tmp[4];
+	_mm256_storeu_si256((__m256i *)tmp, sum);
+	return tmp[0] + tmp[1] + tmp[2] + tmp[3];
+}
+#endif
+
+static uint64_t dot(const uint64_t a[restrict 256],
+					const uint8_t b[restrict 256])
+{
+#ifdef HAVE_AVX2
+	if (__builtin_cpu_supports("avx2"))
+		return dot_avx2(a, b);
+#endif
+
+	return dot_scalar(a, b);
+}
+
+static uint8_t count_ones(uint16_t code)
+{
+	uint8_t ones = 0;
+	for (; code != 0; code >>= 1)
+		ones += code & 1;
+
+	return ones;
+}
+
+/* Stuffing needs a 0xFF byte. The bits are taken as independent with the
+ * average ratio of one bits of the payload. */
+static void finish(const uint64_t freq[restrict 256], uint64_t header_bytes,
+				   uint64_t one_bits, struct huff_estimate * restrict estimate)
+{
+	uint64_t payload_bytes = (estimate->payload_bits + 7) / 8;
+
+	double p1 = 0.0;
+	if (estimate->payload_bits > 0)
+		p1 = (double)one_bits / estimate->payload_bits;
+
+	estimate->header_bytes = header_bytes;
+	estimate->stuffed_bytes = payload_bytes * pow(p1, 8) + 0.5;
+	estimate->total_bytes = estimate->header_bytes + payload_bytes +
+		estimate->stuffed_bytes;
+	estimate->entropy_bits = huff_entropy_bits(freq);
+}
+
+static bool check_codes(const uint64_t freq[restrict 256],
+						const uint8_t code_len[restrict 256])
+{
+	for (int i = 0; i < 256; i++) {
+		if (freq[i] != 0 && code_len[i] == 0)
+			return false;
+	}
+
+	return true;
+}
+
+bool huff_estimate_lengths(const uint64_t freq[restrict 256],
+						   const uint8_t code_len[restrict 256],
+						   struct huff_estimate * restrict estimate)
+{
+	assert(freq     != NULL);
+	assert(code_len != NULL);
+	assert(estimate != NULL);
+
+	if (!check_codes(freq, code_len))
+		return false;
+
+	/* canonical codes with symbols of the same length in ascending order */
+	uint8_t ones[256] = { 0 };
+	uint16_t num_codes = 0;
+	uint16_t code = 0;
+
+	for (uint8_t len = 1; len <= 16; len++) {
+		for (int i = 0; i < 256; i++) {
+			if (code_len[i] != len)
+				continue;
+
+			ones[i] = count_ones(code);
+			code++;
+			num_codes++;
+		}
+
+		code <<= 1;
+	}
+
+	estimate->payload_bits = dot(freq, code_len);
+	finish(freq, DHT_BASE_BYTES + num_codes + DNL_BYTES, dot(freq, ones),
+		   estimate);
+	return true;
+}
+
+bool huff_estimate_enc(const uint64_t freq[restrict 256],
+					   const struct huff_enc * restrict encoder,
+					   struct huff_estimate * restrict estimate)
+{
+	assert(freq     != NULL);
+	assert(encoder  != NULL);
+	assert(estimate != NULL);
+
+	uint8_t code_len[256];
+	uint8_t ones[256];
+
+	for (int i = 0; i < 256; i++) {
+		uint32_t entry = encoder->lookup[i];
+		code_len[i] = entry & 0xFF;
+		ones[i] = count_ones(entry >> 8);
+	}
+
+	if (!check_codes(freq, code_len))
+		return false;
+
+	/* encoders from a predefined table only reference it */
+	uint64_t header_bytes = DNL_BYTES + ((encoder->codes == NULL) ? DTR_BYTES :
+										 DHT_BASE_BYTES + encoder->num_codes);
+
+	estimate->payload_bits = dot(freq, code_len);
+	finish(freq, header_bytes, dot(freq, ones), estimate);
+	return true;
+}
+
+double huff_entropy_bits(const uint64_t freq[restrict 256])
+{
+	assert(freq != NULL);
+
+	uint64_t total = 0;
+	for (int i = 0; i < 256; i++)
+		total += freq[i];
+
+	double sum = 0.0;
+	for (int i = 0; i < 256; i++) {
+		if (freq[i] == 0)
+			continue;
+
+		sum += freq[i] * log2((double)total / freq[i]);
+	}
+
+	return sum;
+}
@@ -0,0 +1,34 @@
+/*
+ * @file huff_estimate.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Size of the encoded output from a histogram, without encoding.
+ */
+
+#ifndef HUFF_ESTIMATE_H
+#define HUFF_ESTIMATE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "huff_enc.h"
+
+struct huff_estimate {
+	uint64_t payload_bits;  /* exact, without padding and stuffing */
+	uint64_t header_bytes;  /* DHT (or DTR) and DNL segment */
+	uint64_t stuffed_bytes; /* estimate of the zero bytes after 0xFF */
+	uint64_t total_bytes;   /* header, padded payload and stuffing */
+	double   entropy_bits;  /* lower bound of payload_bits for any code */
+};
+
+/* code_len is indexed by symbol, 0 if the symbol has no code. Returns false
+ * if a symbol of the histogram has no code. */
+bool huff_estimate_lengths(const uint64_t freq[restrict 256],
+						   const uint8_t code_len[restrict 256],
+						   struct huff_estimate * restrict estimate);
+bool huff_estimate_enc(const uint64_t freq[restrict 256],
+					   const struct huff_enc * restrict encoder,
+					   struct huff_estimate * restrict estimate);
+/* order-0 entropy of the histogram in bits for all symbols */
+double huff_entropy_bits(const uint64_t freq[restrict 256]);
+
+#endif
@@ -0,0 +1,26 @@
+/*
+ * @file huff_format.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Marker codes of the file format.
+ */
+
+#ifndef HUFF_FORMAT_H
+#define HUFF_FORMAT_H
+
+#define JPG_DHT		(0xC4) /* define huffman table */
+#define JPG_DTR		(0xC8) /* reference to a predefined table by id */
+#define JPG_ILV		(0xCA) /* interleaved lanes: number and size of lanes */
+#define JPG_SKT		(0xCC) /* seek table: bit offsets of checkpoints */
+#define JPG_BLK		(0xCE) /* block: size of its entropy data */
+#define JPG_STR		(0xCF) /* start of a stream with flush points */
+#define JPG_FLS		(0xD0) /* flush point: number of symbols since the last */
+#define JPG_ARC		(0xD1) /* archive entry: size of its blocks and file name */
+#define JPG_XFM		(0xD2) /* transform of the symbols of a block */
+#define JPG_WHT		(0xD3) /* huffman table of 16 bit symbols, 4 byte length */
+#define JPG_CRC		(0xD4) /* CRC32C of the uncompressed data of a block */
+#define JPG_EOI		(0xD9) /* end of a stream */
+#define JPG_DNL		(0xDC) /* number of symbols as 64 bit value */
+
+#endif
+
@@ -0,0 +1,468 @@
+/*
+ * @file huff_lanes.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include "huff_lanes.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+#define AVX2_BLOCK_ROUNDS (64)
+
+static bool force_scalar = false;
+
+void huff_lanes_force_scalar(bool scalar)
+{
+	force_scalar = scalar;
+}
+
+#ifdef HAVE_AVX2
+/* the vector code works on groups of 8 lanes */
+static bool use_avx2(uint8_t num_lanes)
+{
+	return num_lanes % 8 == 0 && !force_scalar &&
+		__builtin_cpu_supports("avx2");
+}
+#endif
+
+/* Every lane is encoded into its own region of the output and moved to its
+ * final place afterwards. A region holds 16 bits per symbol, the padding
+ * byte and LANE_STORE_SLACK bytes for the 64-bit stores. */
+#define LANE_STORE_SLACK (8)
+
+static size_t lane_region(size_t num_sym, uint8_t num_lanes)
+{
+	size_t lane_sym = (num_sym + num_lanes - 1) / num_lanes;
+	return 2 * lane_sym + 1 + LANE_STORE_SLACK;
+}
+
+size_t huff_lanes_bound(size_t num_sym, uint8_t num_lanes)
+{
+	return num_lanes * lane_region(num_sym, num_lanes) + HUFF_LANE_SLACK;
+}
+
+struct lane_writer {
+	uint8_t *start;
+	uint8_t *pos;
+	uint64_t bits; /* pending bits, MSB aligned */
+	uint8_t  num_bits;
+};
+
+static inline void store_be64(uint8_t *p, uint64_t value)
+{
+	p[0] = value >> 56;
+	p[1] = value >> 48;
+	p[2] = value >> 40;
+	p[3] = value >> 32;
+	p[4] = value >> 24;
+	p[5] = value >> 16;
+	p[6] = value >>  8;
+	p[7] = value;
+}
+
+/* Appends the lower len bits of code (1 to 64 bits). Always stores 8 bytes,
+ * incomplete bytes are stored again by the next append. */
+static inline void lane_append(struct lane_writer *writer, uint64_t code,
+							   uint8_t len)
+{
+	uint64_t aligned = code << (64 - len);
+	uint64_t word = writer->bits | (aligned >> writer->num_bits);
+	unsigned total = writer->num_bits + len;
+
+	store_be64(writer->pos, word);
+
+	if (total >= 64) {
+		writer->pos += 8;
+		writer->bits = (writer->num_bits == 0) ? 0 :
+			aligned << (64 - writer->num_bits);
+		writer->num_bits = total - 64;
+	} else {
+		writer->pos += total >> 3;
+		writer->bits = word << (total & ~7u);
+		writer->num_bits = total & 7;
+	}
+}
+
+/* append '1' bits up to the next byte boundary, returns the lane size */
+static size_t lane_finish(struct lane_writer *writer)
+{
+	if (writer->num_bits > 0) {
+		*writer->pos = (writer->bits >> 56) | (0xFF >> writer->num_bits);
+		writer->pos++;
+	}
+
+	return writer->pos - writer->start;
+}
+
+/* encodes the symbols first, first + num_lanes, ... of one lane */
+static bool encode_lane(const uint32_t lookup[restrict 256], size_t first,
+						size_t num_sym, uint8_t num_lanes,
+						const uint8_t in_data[restrict],
+						struct lane_writer * restrict writer)
+{
+	for (size_t i = first; i < num_sym; i += num_lanes) {
+		uint32_t entry = lookup[in_data[i]];
+		uint8_t code_len = entry & 0xFF;
+
+		/* symbol has no code in this table */
+		if (code_len == 0)
+			return false;
+
+		lane_append(writer, entry >> 8, code_len);
+	}
+
+	return true;
+}
+
+#ifdef HAVE_AVX2
+/* Encodes 4 rounds of 8 lanes per step. The codes and lengths of 8 symbols
+ * are gathered from the symbol indexed lookup table, then the codes of the 4
+ * rounds are merged per lane with variable shifts and ORs: two 32-bit words
+ * with rounds 0+1 and 2+3, then one 64-bit word per lane. The merged words
+ * are appended to the lanes with one store each. Returns the number of
+ * encoded rounds or 0 if a symbol has no code. */
+__attribute__((target("avx2")))
+static size_t encode_rounds_avx2(const uint32_t lookup[restrict 256],
+								 size_t num_rounds, uint8_t num_lanes,
+								 const uint8_t in_data[restrict],
+								 struct lane_writer writers[restrict])
+{
+	const int *table = (const int *)lookup;
+	const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+	const __m256i zero = _mm256_setzero_si256();
+	num_rounds &= ~(size_t)3;
+
+	for (size_t r = 0; r < num_rounds; r += 4) {
+		for (int g = 0; g < num_lanes / 8; g++) {
+			__m256i code[4];
+			__m256i len[4];
+			int missing = 0;
+
+			for (int k = 0; k < 4; k++) {
+				const uint8_t *sym = &in_data[(r + k) * num_lanes + 8 * g];
+				__m256i index = _mm256_cvtepu8_epi32(
+					_mm_loadl_epi64((const __m128i *)sym));
+				__m256i entry = _mm256_i32gather_epi32(table, index, 4);
+
+				code[k] = _mm256_srli_epi32(entry, 8);
+				len[k] = _mm256_and_si256(entry, byte_mask);
+				missing |= _mm256_movemask_epi8(_mm256_cmpeq_epi32(len[k], zero));
+			}
+
+			if (missing != 0)
+				return 0;
+
+			/* at most 32 bits per pair */
+			__m256i code01 = _mm256_or_si256(_mm256_sllv_epi32(code[0], len[1]),
+											 code[1]);
+			__m256i code23 = _mm256_or_si256(_mm256_sllv_epi32(code[2], len[3]),
+											 code[3]);
+			__m256i len01 = _mm256_add_epi32(len[0], len[1]);
+			__m256i len23 = _mm256_add_epi32(len[2], len[3]);
+
+			uint64_t words[8];
+			uint64_t lens[8];
+			for (int h = 0; h < 2; h++) {
+				__m256i c01 = _mm256_cvtepu32_epi64(h == 0 ?
+					_mm256_castsi256_si128(code01) :
+					_mm256_extracti128_si256(code01, 1));
+				__m256i c23 = _mm256_cvtepu32_epi64(h == 0 ?
+					_mm256_castsi256_si128(code23) :
+					_mm256_extracti128_si256(code23, 1));
+				__m256i l01 = _mm256_cvtepu32_epi64(h == 0 ?
+					_mm256_castsi256_si128(len01) :
+					_mm256_extracti128_si256(len01, 1));
+				__m256i l23 = _mm256_cvtepu32_epi64(h == 0 ?
+					_mm256_castsi256_si128(len23) :
+					_mm256_extracti128_si256(len23, 1));
+
+				/* at most 64 bits for all 4 rounds */
+				__m256i word = _mm256_or_si256(_mm256_sllv_epi64(c01, l23), c23);
+				_mm256_storeu_si256((__m256i *)&words[4 * h], word);
+				_mm256_storeu_si256((__m256i *)&lens[4 * h],
+									_mm256_add_epi64(l01, l23));
+			}
+
+			for (int l = 0; l < 8; l++)
+				lane_append(&writers[8 * g + l], words[l], lens[l]);
+		}
+	}
+
+	return num_rounds;
+}
+
+#endif
+
+bool huff_encode_lanes(const struct huff_enc * restrict encoder,
+					   size_t num_sym, const uint8_t in_data[restrict],
+					   uint8_t num_lanes, uint8_t out[restrict],
+					   size_t out_size, size_t lane_size[restrict])
+{
+	assert(encoder   != NULL);
+	assert(in_data   != NULL || num_sym == 0);
+	assert(lane_size != NULL);
+	assert(0 < num_lanes && num_lanes <= HUFF_MAX_LANES);
+
+	if (out_size < huff_lanes_bound(num_sym, num_lanes))
+		return false;
+
+	struct huff_timer timer;
+	huff_timer_start(&timer, encoder->stats);
+
+	const size_t region = lane_region(num_sym, num_lanes);
+	struct lane_writer writers[HUFF_MAX_LANES];
+
+	for (uint8_t lane = 0; lane < num_lanes; lane++) {
+		writers[lane].start = &out[lane * region];
+		writers[lane].pos = writers[lane].start;
+		writers[lane].bits = 0;
+		writers[lane].num_bits = 0;
+	}
+
+	size_t first = 0;
+
+#ifdef HAVE_AVX2
+	if (use_avx2(num_lanes)) {
+		size_t num_rounds = num_sym / num_lanes;
+		if (num_rounds >= 4 && encode_rounds_avx2(encoder->lookup, num_rounds,
+												  num_lanes, in_data,
+												  writers) == 0)
+			return false;
+
+		first = (num_rounds & ~(size_t)3) * num_lanes;
+	}
+#endif
+
+	uint64_t payload_bits = 0;
+	size_t start = 0;
+
+	for (uint8_t lane = 0; lane < num_lanes; lane++) {
+		struct lane_writer *writer = &writers[lane];
+
+		if (!encode_lane(encoder->lookup, first + lane, num_sym, num_lanes,
+						 in_data, writer))
+			return false;
+
+		payload_bits += 8 * (uint64_t)(writer->pos - writer->start) +
+			writer->num_bits;
+
+		/* move the lane behind the previous one */
+		lane_size[lane] = lane_finish(writer);
+		memmove(&out[start], writer->start, lane_size[lane]);
+		start += lane_size[lane];
+	}
+
+	struct huff_stats *stats = encoder->stats;
+	if (stats != NULL) {
+		stats->num_sym += num_sym;
+		stats->in_bytes += num_sym;
+		stats->payload_bits += payload_bits;
+		huff_timer_stop(&timer, stats, HUFF_STAGE_ENCODE);
+	}
+
+	return true;
+}
+
+static inline uint64_t load_be64(const uint8_t *p)
+{
+	return (uint64_t)p[0] << 56 | (uint64_t)p[1] << 48 |
+		(uint64_t)p[2] << 40 | (uint64_t)p[3] << 32 |
+		(uint64_t)p[4] << 24 | (uint64_t)p[5] << 16 |
+		(uint64_t)p[6] <<  8 | (uint64_t)p[7];
+}
+
+/* decodes symbols first, first + num_lanes, ... of one lane, bit_pos is the
+ * position in the input in bits. Fails if the lane uses more than lane_end
+ * bits. */
+static bool decode_lane(const struct huff_dec * restrict decoder,
+						size_t first, size_t num_sym, uint8_t num_lanes,
+						const uint8_t in[restrict], uint64_t * restrict bit_pos,
+						uint64_t lane_end, uint8_t out_buf[restrict])
+{
+	const uint16_t *table = decoder->entries;
+	const uint8_t shift = 64 - decoder->max_bits;
+	uint64_t pos = *bit_pos;
+
+	for (size_t i = first; i < num_sym; i += num_lanes) {
+		if (pos > lane_end)
+			return false;
+
+		uint64_t bits = load_be64(&in[pos >> 3]) << (pos & 7);
+		uint16_t entry = table[bits >> shift];
+		out_buf[i] = entry >> 8;
+		pos += entry & 0xFF;
+	}
+
+	*bit_pos = pos;
+	return pos <= lane_end;
+}
+
+#ifdef HAVE_AVX2
+/* Decodes 8 lanes per vector: the next 32 bits of every lane are gathered,
+ * shifted into place and used as index for a gather from the decode table.
+ * Only full rounds (one symbol in every lane) are decoded. A block of rounds
+ * is only started if no lane can read past the input and its slack, so
+ * corrupt lanes can't cause reads out of bounds. Returns the number of
+ * decoded rounds. */
+__attribute__((target("avx2")))
+static size_t decode_rounds_avx2(const struct huff_dec * restrict decoder,
+								 size_t num_rounds, uint8_t num_lanes,
+								 const uint8_t in[restrict], size_t in_size,
+								 uint64_t bit_pos[restrict],
+								 uint8_t out_buf[restrict])
+{
+	const int num_groups = num_lanes / 8;
+	const int *table = (const int *)decoder->entries;
+	const __m128i index_shift = _mm_cvtsi32_si128(32 - decoder->max_bits);
+	const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+	const __m256i bit_mask = _mm256_set1_epi32(7);
+	const __m256i bswap = _mm256_setr_epi8(
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+	__m256i offset[2];
+	__m256i shift[2];
+	for (int g = 0; g < num_groups; g++) {
+		int32_t tmp_off[8];
+		int32_t tmp_shift[8];
+		for (int l = 0; l < 8; l++) {
+			tmp_off[l] = bit_pos[8 * g + l] >> 3;
+			tmp_shift[l] = bit_pos[8 * g + l] & 7;
+		}
+
+		offset[g] = _mm256_loadu_si256((const __m256i *)tmp_off);
+		shift[g] = _mm256_loadu_si256((const __m256i *)tmp_shift);
+	}
+
+	size_t r = 0;
+	while (r < num_rounds) {
+		size_t block = num_rounds - r;
+		if (block > AVX2_BLOCK_ROUNDS)
+			block = AVX2_BLOCK_ROUNDS;
+
+		/* every round reads 4 bytes and advances at most 2 bytes */
+		int64_t max_offset = (int64_t)in_size + HUFF_LANE_SLACK - 4 - 2 * block;
+		if (max_offset < 0)
+			break;
+
+		__m256i limit = _mm256_set1_epi32(max_offset);
+		int over = 0;
+		for (int g = 0; g < num_groups; g++)
+			over |= _mm256_movemask_epi8(_mm256_cmpgt_epi32(offset[g], limit));
+
+		if (over != 0)
+			break;
+
+		for (size_t end = r + block; r < end; r++) {
+			for (int g = 0; g < num_groups; g++) {
+				__m256i bits = _mm256_i32gather_epi32((const int *)in,
+													  offset[g], 1);
+				bits = _mm256_shuffle_epi8(bits, bswap);
+				bits = _mm256_sllv_epi32(bits, shift[g]);
+
+				__m256i index = _mm256_srl_epi32(bits, index_shift);
+				__m256i entry = _mm256_i32gather_epi32(table, index, 2);
+				__m256i len = _mm256_and_si256(entry, byte_mask);
+				__m256i sym = _mm256_and_si256(_mm256_srli_epi32(entry, 8),
+											   byte_mask);
+
+				__m256i total = _mm256_add_epi32(shift[g], len);
+				offset[g] = _mm256_add_epi32(offset[g],
+											 _mm256_srli_epi32(total, 3));
+				shift[g] = _mm256_and_si256(total, bit_mask);
+
+				/* 8 x 32 bit -> 8 x 8 bit */
+				sym = _mm256_packus_epi32(sym, sym);
+				sym = _mm256_packus_epi16(sym, sym);
+				__m128i bytes = _mm_unpacklo_epi32(
+					_mm256_castsi256_si128(sym),
+					_mm256_extracti128_si256(sym, 1));
+				_mm_storel_epi64((__m128i *)&out_buf[r * num_lanes + 8 * g],
+								 bytes);
+			}
+		}
+	}
+
+	for (int g = 0; g < num_groups; g++) {
+		int32_t tmp_off[8];
+		int32_t tmp_shift[8];
+		_mm256_storeu_si256((__m256i *)tmp_off, offset[g]);
+		_mm256_storeu_si256((__m256i *)tmp_shift, shift[g]);
+
+		for (int l = 0; l < 8; l++)
+			bit_pos[8 * g + l] = ((uint64_t)tmp_off[l] << 3) + tmp_shift[l];
+	}
+
+	return r;
+}
+
+#endif
+
+/* in needs HUFF_LANE_SLACK readable bytes after the last lane */
+bool huff_decode_lanes(const struct huff_dec * restrict decoder,
+					   size_t num_sym, const uint8_t in[restrict],
+					   const size_t lane_size[restrict], uint8_t num_lanes,
+					   uint8_t out_buf[restrict])
+{
+	assert(decoder   != NULL);
+	assert(in        != NULL);
+	assert(lane_size != NULL);
+	assert(out_buf   != NULL || num_sym == 0);
+	assert(0 < num_lanes && num_lanes <= HUFF_MAX_LANES);
+
+	if (decoder->entries == NULL) {
+		fprintf(stderr, "Lanes can only be decoded with a decode table\n");
+		return false;
+	}
+
+	struct huff_timer timer;
+	huff_timer_start(&timer, decoder->stats);
+
+	uint64_t bit_pos[HUFF_MAX_LANES];
+	uint64_t lane_end[HUFF_MAX_LANES];
+	size_t in_size = 0;
+
+	for (uint8_t lane = 0; lane < num_lanes; lane++) {
+		bit_pos[lane] = (uint64_t)in_size << 3;
+		in_size += lane_size[lane];
+		lane_end[lane] = (uint64_t)in_size << 3;
+	}
+
+	size_t first = 0;
+
+#ifdef HAVE_AVX2
+	/* gather offsets are signed 32 bit */
+	if (use_avx2(num_lanes) && in_size + HUFF_LANE_SLACK <= INT32_MAX) {
+		size_t num_rounds = decode_rounds_avx2(decoder, num_sym / num_lanes,
+											   num_lanes, in, in_size, bit_pos,
+											   out_buf);
+		first = num_rounds * num_lanes;
+	}
+#endif
+
+	/* remaining rounds and the last incomplete round */
+	for (uint8_t lane = 0; lane < num_lanes; lane++) {
+		/* a lane must not use bits of the next lane */
+		if (!decode_lane(decoder, first + lane, num_sym, num_lanes, in,
+						 &bit_pos[lane], lane_end[lane], out_buf)) {
+			fprintf(stderr, "Unexpected end of input data\n");
+			return false;
+		}
+	}
+
+	if (decoder->stats != NULL) {
+		decoder->stats->num_sym += num_sym;
+		decoder->stats->out_bytes += num_sym;
+		huff_timer_stop(&timer, decoder->stats, HUFF_STAGE_DECODE);
+	}
+
+	return true;
+}
+
@@ -0,0 +1,37 @@
+/*
+ * @file huff_lanes.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Encoding and decoding of interleaved lanes.
+ */
+
+#ifndef HUFF_LANES_H
+#define HUFF_LANES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "huff_enc.h"
+#include "huff_dec.h"
+
+#define HUFF_MAX_LANES  (16)
+#define HUFF_LANE_SLACK (8) /* readable bytes required after the last lane */
+
+/* Symbol i is coded in lane i % num_lanes. Every lane is a bit stream without
+ * byte stuffing, padded with '1' bits to a byte boundary. The lanes are
+ * stored back to back, lane_size holds the size of every lane in bytes. */
+size_t huff_lanes_bound(size_t num_sym, uint8_t num_lanes);
+/* disables the AVX2 kernels for 8 and 16 lanes, e.g. to compare them with
+ * the scalar code; not thread safe */
+void huff_lanes_force_scalar(bool scalar);
+bool huff_encode_lanes(const struct huff_enc * restrict encoder,
+					   size_t num_sym, const uint8_t in_data[restrict],
+					   uint8_t num_lanes, uint8_t out[restrict],
+					   size_t out_size, size_t lane_size[restrict]);
+bool huff_decode_lanes(const struct huff_dec * restrict decoder,
+					   size_t num_sym, const uint8_t in[restrict],
+					   const size_t lane_size[restrict], uint8_t num_lanes,
+					   uint8_t out_buf[restrict]);
+
+#endif
+
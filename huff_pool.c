@@ -0,0 +1,243 @@
+/*
+ * @file huff_pool.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <pthread.h>
+#include "huff_pool.h"
+
+struct task {
+	void (*func)(void *arg);
+	void *arg;
+};
+
+/* ring buffer, the owner takes from the tail and thieves from the head */
+struct deque {
+	pthread_mutex_t lock;
+	struct task *tasks;
+	size_t capacity; /* power of two */
+	size_t head;
+	size_t tail;
+};
+
+struct worker {
+	struct huff_pool *pool;
+	unsigned index;
+	pthread_t thread;
+};
+
+struct huff_pool {
+	unsigned num_threads;
+	unsigned num_started;
+	struct deque deques[HUFF_POOL_MAX_THREADS];
+	struct worker workers[HUFF_POOL_MAX_THREADS];
+	unsigned next; /* deque of the next submitted task */
+
+	pthread_mutex_t lock;
+	pthread_cond_t work; /* signaled when a task was submitted */
+	pthread_cond_t done; /* signaled when no task is pending */
+	size_t queued;       /* tasks in the deques */
+	size_t pending;      /* tasks queued or running */
+	bool stop;
+};
+
+static bool push(struct deque *deque, struct task task)
+{
+	pthread_mutex_lock(&deque->lock);
+
+	if (deque->tail - deque->head == deque->capacity) {
+		size_t capacity = (deque->capacity == 0) ? 64 : 2 * deque->capacity;
+		struct task *tasks = malloc(capacity * sizeof(*tasks));
+		if (tasks == NULL) {
+			pthread_mutex_unlock(&deque->lock);
+			return false;
+		}
+
+		for (size_t i = deque->head; i != deque->tail; i++)
+			tasks[i & (capacity - 1)] = deque->tasks[i & (deque->capacity - 1)];
+
+		free(deque->tasks);
+		deque->tasks = tasks;
+		deque->capacity = capacity;
+	}
+
+	deque->tasks[deque->tail & (deque->capacity - 1)] = task;
+	deque->tail++;
+
+	pthread_mutex_unlock(&deque->lock);
+	return true;
+}
+
+static bool take(struct deque *deque, bool steal, struct task *task)
+{
+	pthread_mutex_lock(&deque->lock);
+
+	bool found = deque->head != deque->tail;
+	if (found && steal)
+		*task = deque->tasks[deque->head++ & (deque->capacity - 1)];
+	else if (found)
+		*task = deque->tasks[--deque->tail & (deque->capacity - 1)];
+
+	pthread_mutex_unlock(&deque->lock);
+	return found;
+}
+
+static bool next_task(struct huff_pool *pool, unsigned index, struct task *task)
+{
+	if (take(&pool->deques[index], false, task))
+		return true;
+
+	for (unsigned i = 1; i < pool->num_threads; i++) {
+		if (take(&pool->deques[(index + i) % pool->num_threads], true, task))
+			return true;
+	}
+
+	return false;
+}
+
+static void *worker_main(void *arg)
+{
+	struct worker *worker = arg;
+	struct huff_pool *pool = worker->pool;
+
+	for (;;) {
+		struct task task;
+
+		if (next_task(pool, worker->index, &task)) {
+			pthread_mutex_lock(&pool->lock);
+			pool->queued--;
+			pthread_mutex_unlock(&pool->lock);
+
+			task.func(task.arg);
+
+			pthread_mutex_lock(&pool->lock);
+			if (--pool->pending == 0)
+				pthread_cond_broadcast(&pool->done);
+			pthread_mutex_unlock(&pool->lock);
+			continue;
+		}
+
+		/* a submitted task may not be pushed yet, then the deques are
+		 * searched again */
+		pthread_mutex_lock(&pool->lock);
+		while (pool->queued == 0 && !pool->stop)
+			pthread_cond_wait(&pool->work, &pool->lock);
+
+		bool stop = pool->queued == 0 && pool->stop;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (stop)
+			return NULL;
+	}
+}
+
+struct huff_pool *huff_pool_create(unsigned num_threads)
+{
+	if (num_threads == 0 || num_threads > HUFF_POOL_MAX_THREADS) {
+		fprintf(stderr, "Number of threads must be between 1 and %d\n",
+				HUFF_POOL_MAX_THREADS);
+		return NULL;
+	}
+
+	struct huff_pool *pool = calloc(1, sizeof(*pool));
+	if (pool == NULL) {
+		perror("Couldn't allocate thread pool");
+		return NULL;
+	}
+
+	pool->num_threads = num_threads;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	for (unsigned i = 0; i < num_threads; i++)
+		pthread_mutex_init(&pool->deques[i].lock, NULL);
+
+	for (unsigned i = 0; i < num_threads; i++) {
+		struct worker *worker = &pool->workers[i];
+		worker->pool = pool;
+		worker->index = i;
+
+		if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+			fprintf(stderr, "Couldn't create thread\n");
+			huff_pool_destroy(pool);
+			return NULL;
+		}
+
+		pool->num_started++;
+	}
+
+	return pool;
+}
+
+void huff_pool_destroy(struct huff_pool *pool)
+{
+	if (pool == NULL)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = true;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (unsigned i = 0; i < pool->num_started; i++)
+		pthread_join(pool->workers[i].thread, NULL);
+
+	for (unsigned i = 0; i < pool->num_threads; i++) {
+		pthread_mutex_destroy(&pool->deques[i].lock);
+		free(pool->deques[i].tasks);
+	}
+
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->work);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
+
+bool huff_pool_submit(struct huff_pool *pool, void (*func)(void *arg),
+					  void *arg)
+{
+	assert(pool != NULL);
+	assert(func != NULL);
+
+	pthread_mutex_lock(&pool->lock);
+	unsigned index = pool->next;
+	pool->next = (pool->next + 1) % pool->num_threads;
+	pool->queued++;
+	pool->pending++;
+	pthread_mutex_unlock(&pool->lock);
+
+	bool ok = push(&pool->deques[index], (struct task){ func, arg });
+
+	pthread_mutex_lock(&pool->lock);
+	if (ok) {
+		pthread_cond_signal(&pool->work);
+	} else {
+		pool->queued--;
+		if (--pool->pending == 0)
+			pthread_cond_broadcast(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	if (!ok)
+		perror("Couldn't queue task");
+
+	return ok;
+}
+
+void huff_pool_wait(struct huff_pool *pool)
+{
+	assert(pool != NULL);
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->pending > 0)
+		pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,29 @@
+/*
+ * @file huff_pool.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Work stealing thread pool.
+ */
+
+#ifndef HUFF_POOL_H
+#define HUFF_POOL_H
+
+#include <stdbool.h>
+
+#define HUFF_POOL_MAX_THREADS (64)
+
+/* Every worker has its own deque. Submitted tasks are distributed round
+ * robin, a worker runs the newest task of its own deque and steals the
+ * oldest task of another deque once its own is empty. */
+struct huff_pool;
+
+struct huff_pool *huff_pool_create(unsigned num_threads);
+/* waits for all tasks and stops the workers */
+void huff_pool_destroy(struct huff_pool *pool);
+
+bool huff_pool_submit(struct huff_pool *pool, void (*func)(void *arg),
+					  void *arg);
+/* returns once every submitted task is done */
+void huff_pool_wait(struct huff_pool *pool);
+
+#endif
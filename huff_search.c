@@ -0,0 +1,274 @@
+/*
+ * @file huff_search.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "huff_crc.h"
+#include "huff_search.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+#define SEARCH_CHUNK_SIZE (16 * 1024)
+
+/* the inverse transform of a chunk can be much larger than the chunk */
+#define SEARCH_XFM_CHUNK_SIZE (1024)
+
+static void report(struct huff_search *search, uint64_t offset)
+{
+	search->num_matches++;
+
+	if (search->found != NULL)
+		search->found(offset, search->arg);
+}
+
+/* matches that start at start or after */
+static void find_scalar(struct huff_search * restrict search,
+						const uint8_t data[restrict], size_t start,
+						size_t size, uint64_t base)
+{
+	const uint8_t *pattern = search->pattern;
+	size_t len = search->len;
+
+	for (size_t i = start; i + len <= size; i++) {
+		const uint8_t *hit = memchr(&data[i], pattern[0], size - len + 1 - i);
+		if (hit == NULL)
+			return;
+
+		i = hit - data;
+		if (memcmp(&data[i], pattern, len) == 0)
+			report(search, base + i);
+	}
+}
+
+#ifdef HAVE_AVX2
+/* Compares the first and the last byte of the pattern at 32 positions at
+ * once, only the candidates are compared completely. Returns the first
+ * position that wasn't searched. */
+__attribute__((target("avx2")))
+static size_t find_avx2(struct huff_search * restrict search,
+						const uint8_t data[restrict], size_t size,
+						uint64_t base)
+{
+	const uint8_t *pattern = search->pattern;
+	size_t len = search->len;
+
+	__m256i first = _mm256_set1_epi8((char)pattern[0]);
+	__m256i last = _mm256_set1_epi8((char)pattern[len - 1]);
+
+	size_t i = 0;
+	for (; i + len - 1 + 32 <= size; i += 32) {
+		__m256i a = _mm256_loadu_si256((const __m256i *)&data[i]);
+		__m256i b = _mm256_loadu_si256((const __m256i *)&data[i + len - 1]);
+		__m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+									  _mm256_cmpeq_epi8(b, last));
+		uint32_t mask = _mm256_movemask_epi8(eq);
+
+		while (mask != 0) {
+			size_t pos = i + __builtin_ctz(mask);
+			if (len <= 2 || memcmp(&data[pos + 1], &pattern[1], len - 2) == 0)
+				report(search, base + pos);
+			mask &= mask - 1;
+		}
+	}
+
+	return i;
+}
+#endif
+
+/* all matches that lie completely in data */
+static void find(struct huff_search * restrict search,
+				 const uint8_t data[restrict], size_t size, uint64_t base)
+{
+	size_t start = 0;
+
+#ifdef HAVE_AVX2
+	if (__builtin_cpu_supports("avx2"))
+		start = find_avx2(search, data, size, base);
+#endif
+
+	find_scalar(search, data, start, size, base);
+}
+
+bool huff_search_init(struct huff_search * restrict search,
+					  const uint8_t pattern[restrict], size_t len,
+					  huff_search_fn found, void *arg)
+{
+	assert(search  != NULL);
+	assert(pattern != NULL);
+
+	if (len == 0 || len > HUFF_SEARCH_MAX_LEN) {
+		fprintf(stderr, "Pattern must have 1 to %d bytes\n",
+				HUFF_SEARCH_MAX_LEN);
+		return false;
+	}
+
+	memset(search, 0, sizeof(*search));
+	memcpy(search->pattern, pattern, len);
+	search->len = len;
+	search->found = found;
+	search->arg = arg;
+
+	search->buffer = malloc(huff_untransform_bound(SEARCH_XFM_CHUNK_SIZE));
+	if (search->buffer == NULL) {
+		perror("Couldn't allocate search buffer");
+		return false;
+	}
+
+	return true;
+}
+
+void huff_search_destroy(struct huff_search *search)
+{
+	if (search == NULL)
+		return;
+
+	free(search->buffer);
+	search->buffer = NULL;
+}
+
+void huff_search_data(struct huff_search * restrict search,
+					  const uint8_t data[restrict], size_t size)
+{
+	assert(search != NULL);
+	assert(data   != NULL || size == 0);
+
+	size_t keep = search->len - 1;
+
+	/* A match across the border starts in the tail. The first len - 1
+	 * bytes of data are too short for a match of their own. */
+	if (search->tail_len > 0) {
+		uint8_t border[2 * HUFF_SEARCH_MAX_LEN];
+		size_t head = (size < keep) ? size : keep;
+
+		memcpy(border, search->tail, search->tail_len);
+		memcpy(&border[search->tail_len], data, head);
+		find(search, border, search->tail_len + head,
+			 search->offset - search->tail_len);
+	}
+
+	find(search, data, size, search->offset);
+	search->offset += size;
+
+	if (size >= keep) {
+		memcpy(search->tail, &data[size - keep], keep);
+		search->tail_len = keep;
+		return;
+	}
+
+	size_t total = search->tail_len + size;
+	size_t old = (total > keep) ? total - keep : 0;
+
+	memmove(search->tail, &search->tail[old], search->tail_len - old);
+	memcpy(&search->tail[search->tail_len - old], data, size);
+	search->tail_len = search->tail_len - old + size;
+}
+
+static bool contains(const uint8_t symbols[], size_t num_symbols, uint8_t sym)
+{
+	return memchr(symbols, sym, num_symbols) != NULL;
+}
+
+bool huff_search_can_match(const struct huff_search * restrict search,
+						   const uint8_t symbols[restrict], size_t num_symbols)
+{
+	assert(search  != NULL);
+	assert(symbols != NULL || num_symbols == 0);
+
+	for (size_t i = 0; i < search->len; i++) {
+		if (!contains(symbols, num_symbols, search->pattern[i]))
+			return false;
+	}
+
+	return true;
+}
+
+bool huff_search_can_start(const struct huff_search * restrict search,
+						   const uint8_t symbols[restrict], size_t num_symbols)
+{
+	assert(search  != NULL);
+	assert(symbols != NULL || num_symbols == 0);
+
+	return contains(symbols, num_symbols, search->pattern[0]);
+}
+
+bool huff_search_decode(struct huff_search * restrict search,
+						const struct huff_dec * restrict decoder,
+						size_t num_sym, struct bit_reader * restrict reader)
+{
+	assert(search  != NULL);
+	assert(decoder != NULL);
+	assert(reader  != NULL);
+
+	uint8_t buffer[SEARCH_CHUNK_SIZE];
+	size_t chunk = sizeof(buffer);
+	if (decoder->untransform != NULL)
+		chunk = SEARCH_XFM_CHUNK_SIZE;
+
+	struct huff_timer timer;
+	huff_timer_start(&timer, decoder->stats);
+
+	uint64_t total = num_sym;
+	while (num_sym > 0) {
+		size_t len = (num_sym < chunk) ? num_sym : chunk;
+
+		if (!decoder->decode(decoder, len, reader, buffer)) {
+			fprintf(stderr, "Unexpected end of input data\n");
+			return false;
+		}
+
+		const uint8_t *data = buffer;
+		size_t size = len;
+		if (decoder->untransform != NULL) {
+			size = huff_untransform(decoder->untransform, buffer, len,
+									search->buffer);
+			data = search->buffer;
+		}
+
+		if (decoder->crc != NULL)
+			*decoder->crc = huff_crc32c(*decoder->crc, data, size);
+
+		huff_search_data(search, data, size);
+
+		num_sym -= len;
+	}
+
+	if (decoder->stats != NULL) {
+		decoder->stats->num_sym += total;
+		huff_timer_stop(&timer, decoder->stats, HUFF_STAGE_DECODE);
+	}
+
+	return true;
+}
+
+bool huff_search_skip(struct huff_search * restrict search,
+					  const struct huff_dec * restrict decoder,
+					  size_t num_sym, struct bit_reader * restrict reader)
+{
+	assert(search  != NULL);
+	assert(decoder != NULL);
+	assert(decoder->untransform == NULL);
+
+	/* without a tail no match from before reaches into the data */
+	size_t head = 0;
+	if (search->tail_len > 0)
+		head = (num_sym < search->len - 1) ? num_sym : search->len - 1;
+
+	if (head > 0 && !huff_search_decode(search, decoder, head, reader))
+		return false;
+
+	if (head < num_sym) {
+		search->offset += num_sym - head;
+		search->num_skipped += num_sym - head;
+		search->tail_len = 0;
+	}
+
+	return true;
+}
@@ -0,0 +1,70 @@
+/*
+ * @file huff_search.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Search of a pattern in huffman coded data without writing it out.
+ */
+
+#ifndef HUFF_SEARCH_H
+#define HUFF_SEARCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "bit_reader.h"
+#include "huff_dec.h"
+
+#define HUFF_SEARCH_MAX_LEN (256)
+
+/* offset of the match in the decoded data */
+typedef void (*huff_search_fn)(uint64_t offset, void *arg);
+
+/* The decoded data is searched chunk by chunk, the last len - 1 bytes of a
+ * chunk are kept for matches across the border to the next chunk. */
+struct huff_search {
+	uint8_t pattern[HUFF_SEARCH_MAX_LEN];
+	size_t len;
+
+	/* optional, called for every match in ascending order */
+	huff_search_fn found;
+	void *arg;
+
+	uint64_t offset; /* decoded bytes so far */
+	uint8_t tail[HUFF_SEARCH_MAX_LEN];
+	size_t tail_len;
+
+	uint8_t *buffer; /* output of the inverse transform */
+
+	uint64_t num_matches;
+	uint64_t num_skipped; /* symbols which weren't decoded */
+};
+
+bool huff_search_init(struct huff_search * restrict search,
+					  const uint8_t pattern[restrict], size_t len,
+					  huff_search_fn found, void *arg);
+void huff_search_destroy(struct huff_search *search);
+
+/* searches the next chunk of decoded data */
+void huff_search_data(struct huff_search * restrict search,
+					  const uint8_t data[restrict], size_t size);
+
+/* Checks the symbols of a table: can_match is false if the pattern has a
+ * symbol that isn't in the table, can_start if the first one isn't. */
+bool huff_search_can_match(const struct huff_search * restrict search,
+						   const uint8_t symbols[restrict], size_t num_symbols);
+bool huff_search_can_start(const struct huff_search * restrict search,
+						   const uint8_t symbols[restrict], size_t num_symbols);
+
+/* decodes num_sym symbols into a small buffer and searches them, the crc of
+ * the decoder is updated like by huff_decode_file */
+bool huff_search_decode(struct huff_search * restrict search,
+						const struct huff_dec * restrict decoder,
+						size_t num_sym, struct bit_reader * restrict reader);
+/* For data in which no match can start (see huff_search_can_start) and
+ * without transform: only the first len - 1 symbols are decoded, for a match
+ * that started before. */
+bool huff_search_skip(struct huff_search * restrict search,
+					  const struct huff_dec * restrict decoder,
+					  size_t num_sym, struct bit_reader * restrict reader);
+
+#endif
@@ -0,0 +1,259 @@
+/*
+ * @file huff_seek.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ */
+
+#define _POSIX_C_SOURCE 200112L
+#define _FILE_OFFSET_BITS 64
+
+#include <stdlib.h>
+#include <assert.h>
+#include <sys/types.h>
+#include "bit_reader.h"
+#include "huff_format.h"
+#include "huff_seek.h"
+
+#define SKIP_CHUNK_SIZE (4096)
+
+bool huff_seek_init(struct huff_seek *seek, uint32_t interval,
+					uint64_t num_sym)
+{
+	assert(seek != NULL);
+	assert(interval > 0);
+
+	seek->interval = interval;
+	seek->num_points = (num_sym > 0) ? (num_sym - 1) / interval : 0;
+	seek->points = NULL;
+	seek->num_sym = 0;
+	seek->next = 0;
+	seek->data_start = 0;
+
+	if (seek->num_points == 0)
+		return true;
+
+	seek->points = calloc(seek->num_points, sizeof(*seek->points));
+	if (seek->points == NULL) {
+		perror("Couldn't allocate seek table");
+		return false;
+	}
+
+	return true;
+}
+
+void huff_seek_destroy(struct huff_seek *seek)
+{
+	assert(seek != NULL);
+
+	free(seek->points);
+	seek->points = NULL;
+	seek->num_points = 0;
+}
+
+static size_t num_segments(const struct huff_seek *seek)
+{
+	if (seek->num_points == 0)
+		return 1;
+
+	return (seek->num_points + HUFF_SEEK_SEG_POINTS - 1) / HUFF_SEEK_SEG_POINTS;
+}
+
+size_t huff_seek_size(const struct huff_seek *seek)
+{
+	assert(seek != NULL);
+
+	return 8 * num_segments(seek) + 8 * seek->num_points;
+}
+
+bool huff_seek_write(FILE *out, const struct huff_seek *seek)
+{
+	assert(out  != NULL);
+	assert(seek != NULL);
+
+	size_t index = 0;
+	for (size_t s = 0; s < num_segments(seek); s++) {
+		size_t n = seek->num_points - index;
+		if (n > HUFF_SEEK_SEG_POINTS)
+			n = HUFF_SEEK_SEG_POINTS;
+
+		uint8_t header[8 + 8 * HUFF_SEEK_SEG_POINTS];
+		uint16_t header_length = 6 + 8 * n;
+		header[0] = 0xFF;
+		header[1] = JPG_SKT;
+		header[2] = header_length >> 8;
+		header[3] = header_length & 0xFF;
+
+		for (int j = 0; j < 4; j++)
+			header[4 + j] = (seek->interval >> (24 - 8 * j)) & 0xFF;
+
+		for (size_t i = 0; i < n; i++) {
+			uint64_t point = seek->points[index + i];
+			for (int j = 0; j < 8; j++)
+				header[8 + 8 * i + j] = (point >> (56 - 8 * j)) & 0xFF;
+		}
+
+		if (fwrite(header, 2 + header_length, 1, out) != 1) {
+			fprintf(stderr, "Couldn't write seek table\n");
+			return false;
+		}
+
+		index += n;
+	}
+
+	return true;
+}
+
+bool huff_seek_read(FILE *in, struct huff_seek *seek)
+{
+	assert(in   != NULL);
+	assert(seek != NULL);
+
+	uint8_t header[6];
+	if (fread(header, sizeof(header), 1, in) != 1) {
+		fprintf(stderr, "Couldn't read seek table\n");
+		return false;
+	}
+
+	uint16_t header_length = (header[0] << 8) | header[1];
+	uint32_t interval = ((uint32_t)header[2] << 24) | (header[3] << 16) |
+		(header[4] << 8) | header[5];
+
+	if (header_length < 6 || (header_length - 6) % 8 != 0 || interval == 0 ||
+		(seek->num_points > 0 && interval != seek->interval)) {
+		fprintf(stderr, "Invalid seek table\n");
+		return false;
+	}
+
+	size_t n = (header_length - 6) / 8;
+	uint64_t *points = realloc(seek->points,
+							   (seek->num_points + n) * sizeof(*points));
+	if (points == NULL && seek->num_points + n != 0) {
+		perror("Couldn't allocate seek table");
+		return false;
+	}
+
+	seek->interval = interval;
+	seek->points = points;
+
+	for (size_t i = 0; i < n; i++) {
+		uint8_t tmp[8];
+		if (fread(tmp, sizeof(tmp), 1, in) != 1) {
+			fprintf(stderr, "Couldn't read seek table\n");
+			return false;
+		}
+
+		uint64_t point = 0;
+		for (int j = 0; j < 8; j++)
+			point = (point << 8) | tmp[j];
+
+		seek->points[seek->num_points] = point;
+		seek->num_points++;
+	}
+
+	return true;
+}
+
+bool huff_seek_start(struct huff_seek *seek, FILE *in)
+{
+	assert(seek != NULL);
+	assert(in   != NULL);
+
+	off_t pos = ftello(in);
+	if (pos < 0) {
+		perror("Couldn't get position of entropy data");
+		return false;
+	}
+
+	seek->data_start = pos;
+	return true;
+}
+
+/* Encodes like huff_encode and records a checkpoint every interval symbols.
+ * Can be called for consecutive chunks of the input. */
+bool huff_encode_seek(const struct huff_enc * restrict encoder,
+					  struct huff_seek * restrict seek, size_t num_sym,
+					  const uint8_t in_data[restrict],
+					  struct bit_writer * restrict writer)
+{
+	assert(encoder != NULL);
+	assert(seek    != NULL);
+	assert(writer  != NULL);
+
+	while (num_sym > 0) {
+		size_t len = num_sym;
+		uint64_t next = (uint64_t)(seek->next + 1) * seek->interval;
+
+		if (seek->next < seek->num_points && next - seek->num_sym < len)
+			len = next - seek->num_sym;
+
+		if (!huff_encode(encoder, len, in_data, writer))
+			return false;
+
+		seek->num_sym += len;
+		in_data += len;
+		num_sym -= len;
+
+		if (seek->next < seek->num_points && seek->num_sym == next) {
+			if (!bit_writer_flush_bits(writer))
+				return false;
+
+			seek->points[seek->next] = bit_writer_tell(writer);
+			seek->next++;
+		}
+	}
+
+	return true;
+}
+
+/* Decodes len symbols starting at symbol offset. Decoding starts at the last
+ * checkpoint before offset, so at most interval - 1 symbols are skipped. */
+bool huff_decode_range(const struct huff_dec * restrict decoder,
+					   const struct huff_seek * restrict seek, FILE *in,
+					   uint64_t offset, size_t len, uint8_t out_buf[restrict])
+{
+	assert(decoder != NULL);
+	assert(seek    != NULL);
+	assert(in      != NULL);
+	assert(out_buf != NULL || len == 0);
+
+	if (len == 0)
+		return true;
+
+	uint64_t index = (seek->num_points > 0) ? offset / seek->interval : 0;
+	if (index > seek->num_points)
+		index = seek->num_points;
+
+	uint64_t bit_pos = (index > 0) ? seek->points[index - 1] : 0;
+	uint64_t skip = offset - index * seek->interval;
+
+	if (fseeko(in, seek->data_start + bit_pos / 8, SEEK_SET) != 0) {
+		perror("Couldn't seek to checkpoint");
+		return false;
+	}
+
+	struct bit_reader *reader = bit_reader_create(in);
+	if (reader == NULL) {
+		fprintf(stderr, "Couldn't create bit reader\n");
+		return false;
+	}
+
+	/* the fast refill needs room in the bit buffer, so only fill if needed */
+	if (bit_pos % 8 != 0) {
+		bit_reader_refill(reader);
+		bit_reader_consume(reader, bit_pos % 8);
+	}
+
+	uint8_t buffer[SKIP_CHUNK_SIZE];
+	bool ok = true;
+
+	while (ok && skip > 0) {
+		size_t n = (skip < sizeof(buffer)) ? skip : sizeof(buffer);
+		ok = huff_decode(decoder, n, reader, buffer);
+		skip -= n;
+	}
+
+	ok = ok && huff_decode(decoder, len, reader, out_buf);
+
+	bit_reader_destroy(reader);
+	return ok;
+}
@@ -0,0 +1,52 @@
+/*
+ * @file huff_seek.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Seek table for random access into an encoded stream.
+ */
+
+#ifndef HUFF_SEEK_H
+#define HUFF_SEEK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "huff_enc.h"
+#include "huff_dec.h"
+
+/* checkpoints per SKT segment, limited by the 16 bit segment length */
+#define HUFF_SEEK_SEG_POINTS (8191)
+
+/* Checkpoint i is the bit offset of symbol (i + 1) * interval from the start
+ * of the (stuffed) entropy data. Symbol 0 is always at offset 0. */
+struct huff_seek {
+	uint32_t  interval;
+	size_t    num_points;
+	uint64_t *points;
+
+	uint64_t  num_sym;    /* encoder: symbols encoded so far */
+	size_t    next;       /* encoder: next checkpoint to record */
+	uint64_t  data_start; /* decoder: file offset of the entropy data */
+};
+
+bool huff_seek_init(struct huff_seek *seek, uint32_t interval,
+					uint64_t num_sym);
+void huff_seek_destroy(struct huff_seek *seek);
+
+/* writes all SKT segments, huff_seek_size bytes */
+size_t huff_seek_size(const struct huff_seek *seek);
+bool huff_seek_write(FILE *out, const struct huff_seek *seek);
+/* reads one SKT segment after its marker and appends the checkpoints */
+bool huff_seek_read(FILE *in, struct huff_seek *seek);
+/* remembers the current position of in as start of the entropy data */
+bool huff_seek_start(struct huff_seek *seek, FILE *in);
+
+bool huff_encode_seek(const struct huff_enc * restrict encoder,
+					  struct huff_seek * restrict seek, size_t num_sym,
+					  const uint8_t in_data[restrict],
+					  struct bit_writer * restrict writer);
+bool huff_decode_range(const struct huff_dec * restrict decoder,
+					   const struct huff_seek * restrict seek, FILE *in,
+					   uint64_t offset, size_t len, uint8_t out_buf[restrict]);
+
+#endif
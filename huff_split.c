@@ -0,0 +1,254 @@
+/*
+ * @file huff_split.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ */
+
+#include <string.h>
+#include <assert.h>
+#include "huff_enc.h"
+#include "huff_split.h"
+
+/* BLK, DHT without symbols and DNL segment */
+#define BLOCK_HEADER_BYTES (12 + 21 + 12)
+
+/* a smaller block hardly pays for its header */
+#define MIN_BLOCK (HUFF_SPLIT_WINDOW / 2)
+
+/* code length for symbols missing in a table, a new table would need one */
+#define MISSING_LEN (16)
+
+/* returns the number of codes, 0 on error */
+static uint16_t code_lengths(const uint64_t freq[restrict 256],
+							 uint8_t len[restrict 256])
+{
+	struct huff_enc enc = { 0 };
+	struct huff_enc_info info;
+	if (!huff_gen_enc(freq, &enc, &info))
+		return 0;
+
+	for (int i = 0; i < 256; i++)
+		len[i] = enc.lookup[i] & 0xFF;
+
+	huff_enc_destroy(&enc);
+	return info.num_codes;
+}
+
+static uint64_t cost(const uint64_t freq[restrict 256],
+					 const uint8_t len[restrict 256])
+{
+	uint64_t bits = 0;
+	for (int i = 0; i < 256; i++) {
+		if (freq[i] != 0)
+			bits += freq[i] * ((len[i] != 0) ? len[i] : MISSING_LEN);
+	}
+
+	return bits;
+}
+
+static uint8_t symbol_at(const struct huff_split *split, uint64_t pos)
+{
+	return split->history[pos % HUFF_SPLIT_HISTORY];
+}
+
+static uint8_t code_len(const uint8_t len[], uint8_t sym)
+{
+	return (len[sym] != 0) ? len[sym] : MISSING_LEN;
+}
+
+void huff_split_init(struct huff_split *split)
+{
+	assert(split != NULL);
+
+	memset(split, 0, sizeof(*split));
+}
+
+/* the oldest step leaves the window, its bytes stay in the block */
+static void slide(struct huff_split *split)
+{
+	const uint32_t *freq = split->step_freq[split->first_step];
+
+	for (int i = 0; i < 256; i++) {
+		split->window_freq[i] -= freq[i];
+		split->block_freq[i] += freq[i];
+	}
+
+	split->window_size -= split->step_size[split->first_step];
+	split->first_step = (split->first_step + 1) % HUFF_SPLIT_STEPS;
+	split->num_steps--;
+}
+
+static void append(struct huff_split * restrict split,
+				   const uint8_t data[restrict], size_t size)
+{
+	while (split->num_steps == HUFF_SPLIT_STEPS ||
+		   (split->num_steps > 0 &&
+			split->window_size + size > HUFF_SPLIT_WINDOW))
+		slide(split);
+
+	size_t start = split->end % HUFF_SPLIT_HISTORY;
+	size_t first = HUFF_SPLIT_HISTORY - start;
+	if (first > size)
+		first = size;
+
+	memcpy(&split->history[start], data, first);
+	memcpy(split->history, &data[first], size - first);
+
+	uint64_t freq[256];
+	huff_get_freq(data, size, freq);
+
+	size_t step = (split->first_step + split->num_steps) % HUFF_SPLIT_STEPS;
+	for (int i = 0; i < 256; i++) {
+		split->step_freq[step][i] = freq[i];
+		split->window_freq[i] += freq[i];
+	}
+
+	split->step_size[step] = size;
+	split->num_steps++;
+	split->window_size += size;
+	split->end += size;
+}
+
+/* saving of a boundary at the start of the window, 0 if there is none */
+static uint64_t saving(const struct huff_split * restrict split,
+					   uint8_t len[restrict 256])
+{
+	uint16_t num_codes = code_lengths(split->window_freq, len);
+	uint64_t own = cost(split->window_freq, len) +
+		8 * (BLOCK_HEADER_BYTES + num_codes);
+	uint64_t old = cost(split->window_freq, split->block_len);
+
+	return (old > own) ? old - own : 0;
+}
+
+/* The candidate is only known to a step. It moves to the byte within a step
+ * around it where the bytes before it are cheaper with the code lengths of
+ * the block and the bytes after it with those of the window. */
+static void refine(struct huff_split *split)
+{
+	uint64_t pos = split->best_pos;
+	uint64_t lo = pos - HUFF_SPLIT_STEP;
+	uint64_t hi = pos + HUFF_SPLIT_STEP;
+
+	if (lo < split->block_start + MIN_BLOCK)
+		lo = split->block_start + MIN_BLOCK;
+	if (lo + HUFF_SPLIT_HISTORY < split->end)
+		lo = split->end - HUFF_SPLIT_HISTORY;
+	if (hi > split->end - split->window_size)
+		hi = split->end - split->window_size;
+	if (lo > pos || hi < pos)
+		return;
+
+	/* difference to a boundary at lo */
+	int64_t diff = 0;
+	int64_t best = 0;
+	uint64_t best_pos = lo;
+
+	for (uint64_t i = lo; i < hi; i++) {
+		uint8_t sym = symbol_at(split, i);
+		diff += code_len(split->block_len, sym) - code_len(split->best_len, sym);
+
+		if (diff < best) {
+			best = diff;
+			best_pos = i + 1;
+		}
+	}
+
+	for (uint64_t i = pos; i < best_pos; i++)
+		split->best_freq[symbol_at(split, i)]++;
+	for (uint64_t i = best_pos; i < pos; i++)
+		split->best_freq[symbol_at(split, i)]--;
+
+	split->best_pos = best_pos;
+}
+
+/* the block continues from the best boundary, returns the carry */
+static size_t split_block(struct huff_split *split)
+{
+	refine(split);
+
+	/* the code lengths of the new block so far */
+	uint64_t freq[256];
+	for (int i = 0; i < 256; i++) {
+		split->block_freq[i] -= split->best_freq[i];
+		freq[i] = split->block_freq[i] + split->window_freq[i];
+	}
+
+	code_lengths(freq, split->block_len);
+	split->block_start = split->best_pos;
+	split->next_update = HUFF_SPLIT_WINDOW;
+	split->candidate = false;
+
+	return split->end - split->block_start;
+}
+
+bool huff_split_add(struct huff_split * restrict split,
+					const uint8_t data[restrict], size_t size,
+					size_t * restrict carry)
+{
+	assert(split != NULL);
+	assert(data  != NULL || size == 0);
+	assert(carry != NULL);
+	assert(size <= HUFF_SPLIT_STEP);
+
+	/* a full block ends at the best boundary so far or before data */
+	if (split->end - split->block_start + size > HUFF_SPLIT_MAX_BLOCK) {
+		if (split->candidate) {
+			append(split, data, size);
+			*carry = split_block(split);
+		} else {
+			uint64_t end = split->end;
+			huff_split_init(split);
+			split->end = end;
+			split->block_start = end;
+			append(split, data, size);
+			*carry = size;
+		}
+
+		return true;
+	}
+
+	append(split, data, size);
+
+	/* only from the bytes before the window, which can't hold a boundary */
+	size_t before = split->end - split->window_size - split->block_start;
+	if (!split->candidate && before >= split->next_update && before > 0) {
+		code_lengths(split->block_freq, split->block_len);
+		split->next_update = 2 * before;
+	}
+
+	/* a boundary needs a full window after it and a block before it */
+	if (split->window_size < HUFF_SPLIT_WINDOW || before < MIN_BLOCK)
+		return false;
+
+	uint8_t len[256];
+	uint64_t gain = saving(split, len);
+	uint64_t pos = split->end - split->window_size;
+
+	/* The bytes between the best boundary and pos go to the current block
+	 * if the boundary moves to pos, their extra cost counts against it. */
+	bool better = (gain > 0);
+	if (better && split->candidate) {
+		uint64_t moved[256];
+		for (int i = 0; i < 256; i++)
+			moved[i] = split->block_freq[i] - split->best_freq[i];
+
+		better = gain + cost(moved, len) >
+			split->best_saving + cost(moved, split->block_len);
+	}
+
+	if (better) {
+		split->candidate = true;
+		split->best_saving = gain;
+		split->best_pos = pos;
+		memcpy(split->best_freq, split->block_freq, sizeof(split->best_freq));
+		memcpy(split->best_len, len, sizeof(split->best_len));
+		return false;
+	}
+
+	if (!split->candidate)
+		return false;
+
+	*carry = split_block(split);
+	return true;
+}
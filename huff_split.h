@@ -0,0 +1,60 @@
+/*
+ * @file huff_split.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Block boundaries where the symbol distribution changes.
+ */
+
+#ifndef HUFF_SPLIT_H
+#define HUFF_SPLIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define HUFF_SPLIT_WINDOW    (32 * 1024)
+#define HUFF_SPLIT_STEP      (8 * 1024)
+#define HUFF_SPLIT_STEPS     (HUFF_SPLIT_WINDOW / HUFF_SPLIT_STEP)
+#define HUFF_SPLIT_HISTORY   (2 * HUFF_SPLIT_WINDOW)
+#define HUFF_SPLIT_MAX_BLOCK (8 * 1024 * 1024)
+
+/* A window slides over the input in steps, its histogram is updated with the
+ * histograms of the steps that enter and leave it. The start of the window is a candidate for
+ * a new block if coding the window with its own code lengths saves more than
+ * the header of a new block, compared to the code lengths of the current
+ * block. The saving grows while the window moves onto the new data, so the
+ * candidate is taken once it stops growing. The boundary is then moved to
+ * the best byte within a step around it. Positions count from the start of
+ * the input. */
+struct huff_split {
+	uint8_t  history[HUFF_SPLIT_HISTORY]; /* ring buffer of the last bytes */
+	uint64_t end;             /* bytes added so far, the window ends here */
+	size_t   window_size;
+	uint64_t window_freq[256];
+	uint32_t step_freq[HUFF_SPLIT_STEPS][256]; /* steps in the window */
+	size_t   step_size[HUFF_SPLIT_STEPS];
+	size_t   first_step;
+	size_t   num_steps;
+
+	uint64_t block_start;
+	uint64_t block_freq[256]; /* bytes of the block before the window */
+	uint8_t  block_len[256];  /* code lengths of block_freq */
+	size_t   next_update;     /* block_len is rebuilt when block_freq doubles */
+
+	/* best boundary so far */
+	bool     candidate;
+	uint64_t best_saving;
+	uint64_t best_pos;
+	uint64_t best_freq[256];  /* block_freq at the boundary */
+	uint8_t  best_len[256];   /* code lengths of the window at the boundary */
+};
+
+void huff_split_init(struct huff_split *split);
+/* Adds the next step of the input, at most HUFF_SPLIT_STEP bytes. Returns
+ * true if a new block starts, carry is the number of bytes at the end of the
+ * input so far (data included) that belong to the new block. */
+bool huff_split_add(struct huff_split * restrict split,
+					const uint8_t data[restrict], size_t size,
+					size_t * restrict carry);
+
+#endif
@@ -0,0 +1,205 @@
+/*
+ * @file huff_stats.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <time.h>
+#include <assert.h>
+#include "huff_stats.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define read_cycles() __rdtsc()
+#else
+#define read_cycles() 0
+#endif
+
+static const char *stage_names[HUFF_NUM_STAGES] = {
+	"gen_enc", "encode", "gen_dec", "decode", "flush"
+};
+
+static uint64_t read_ns(void)
+{
+	struct timespec ts;
+	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+		return 0;
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* without stats the clocks aren't read at all */
+void huff_timer_start(struct huff_timer *timer, const struct huff_stats *stats)
+{
+	assert(timer != NULL);
+
+	if (stats == NULL)
+		return;
+
+	timer->ns = read_ns();
+	timer->cycles = read_cycles();
+}
+
+void huff_timer_stop(const struct huff_timer *timer, struct huff_stats *stats,
+					 enum huff_stage stage)
+{
+	assert(timer != NULL);
+	assert(stage < HUFF_NUM_STAGES);
+
+	if (stats == NULL)
+		return;
+
+	stats->cycles[stage]  += read_cycles() - timer->cycles;
+	stats->time_ns[stage] += read_ns() - timer->ns;
+}
+
+/* elapsed time since huff_timer_start, only if it got stats */
+uint64_t huff_timer_ns(const struct huff_timer *timer)
+{
+	assert(timer != NULL);
+
+	return read_ns() - timer->ns;
+}
+
+static double bits_per_symbol(const struct huff_stats *stats)
+{
+	if (stats->num_sym == 0)
+		return 0.0;
+
+	/* encoding knows the exact payload, decoding only the input size */
+	if (stats->payload_bits != 0)
+		return (double)stats->payload_bits / stats->num_sym;
+
+	return 8.0 * stats->in_bytes / stats->num_sym;
+}
+
+void huff_stats_table(struct huff_stats *stats, uint32_t num_codes,
+					  uint8_t min_bits, uint8_t max_bits)
+{
+	assert(stats != NULL);
+
+	if (num_codes > stats->num_codes)
+		stats->num_codes = num_codes;
+	if (min_bits != 0 && (stats->min_bits == 0 || min_bits < stats->min_bits))
+		stats->min_bits = min_bits;
+	if (max_bits > stats->max_bits)
+		stats->max_bits = max_bits;
+}
+
+void huff_stats_entropy(struct huff_stats *stats, double entropy,
+						double num_sym)
+{
+	assert(stats != NULL);
+
+	double total = stats->entropy_sym + num_sym;
+	if (total > 0.0) {
+		stats->entropy = (stats->entropy * stats->entropy_sym +
+						  entropy * num_sym) / total;
+	}
+
+	stats->entropy_sym = total;
+}
+
+void huff_stats_merge(struct huff_stats * restrict dst,
+					  const struct huff_stats * restrict src)
+{
+	assert(dst != NULL);
+	assert(src != NULL);
+
+	for (int i = 0; i < HUFF_NUM_STAGES; i++) {
+		dst->time_ns[i] += src->time_ns[i];
+		dst->cycles[i]  += src->cycles[i];
+	}
+
+	huff_stats_entropy(dst, src->entropy, src->entropy_sym);
+	huff_stats_table(dst, src->num_codes, src->min_bits, src->max_bits);
+
+	dst->num_sym       += src->num_sym;
+	dst->in_bytes      += src->in_bytes;
+	dst->out_bytes     += src->out_bytes;
+	dst->payload_bits  += src->payload_bits;
+	dst->stuffed_bytes += src->stuffed_bytes;
+	dst->limit_adjust  += src->limit_adjust;
+	dst->num_flush     += src->num_flush;
+	dst->latency_ns    += src->latency_ns;
+
+	if (src->dec_table_size > dst->dec_table_size)
+		dst->dec_table_size = src->dec_table_size;
+	if (src->max_latency_ns > dst->max_latency_ns)
+		dst->max_latency_ns = src->max_latency_ns;
+}
+
+void huff_stats_print(FILE *out, const struct huff_stats *stats)
+{
+	assert(out   != NULL);
+	assert(stats != NULL);
+
+	fprintf(out, "%-10s %14s %16s\n", "stage", "time [us]", "cycles");
+	for (int i = 0; i < HUFF_NUM_STAGES; i++) {
+		fprintf(out, "%-10s %14.1f %16llu\n", stage_names[i],
+				stats->time_ns[i] / 1000.0,
+				(unsigned long long)stats->cycles[i]);
+	}
+
+	fprintf(out, "symbols:          %llu\n",
+			(unsigned long long)stats->num_sym);
+	fprintf(out, "input bytes:      %llu\n",
+			(unsigned long long)stats->in_bytes);
+	fprintf(out, "output bytes:     %llu\n",
+			(unsigned long long)stats->out_bytes);
+	fprintf(out, "bits per symbol:  %.4f (entropy %.4f)\n",
+			bits_per_symbol(stats), stats->entropy);
+	fprintf(out, "stuffed bytes:    %llu\n",
+			(unsigned long long)stats->stuffed_bytes);
+	fprintf(out, "codes:            %u (%u to %u bits)\n",
+			(unsigned)stats->num_codes, (unsigned)stats->min_bits,
+			(unsigned)stats->max_bits);
+	fprintf(out, "decode table:     %lu bytes\n",
+			(unsigned long)stats->dec_table_size);
+	fprintf(out, "length limiting:  %lu adjustments\n",
+			(unsigned long)stats->limit_adjust);
+
+	if (stats->num_flush > 0) {
+		fprintf(out, "flushes:          %llu (latency avg %.1f us, max %.1f us)\n",
+				(unsigned long long)stats->num_flush,
+				stats->latency_ns / 1000.0 / stats->num_flush,
+				stats->max_latency_ns / 1000.0);
+	}
+}
+
+void huff_stats_print_json(FILE *out, const struct huff_stats *stats)
+{
+	assert(out   != NULL);
+	assert(stats != NULL);
+
+	fprintf(out, "{\"stages\": {");
+	for (int i = 0; i < HUFF_NUM_STAGES; i++) {
+		fprintf(out, "%s\"%s\": {\"time_ns\": %llu, \"cycles\": %llu}",
+				(i == 0) ? "" : ", ", stage_names[i],
+				(unsigned long long)stats->time_ns[i],
+				(unsigned long long)stats->cycles[i]);
+	}
+	fprintf(out, "}, ");
+
+	fprintf(out, "\"num_sym\": %llu, \"in_bytes\": %llu, \"out_bytes\": %llu, ",
+			(unsigned long long)stats->num_sym,
+			(unsigned long long)stats->in_bytes,
+			(unsigned long long)stats->out_bytes);
+	fprintf(out, "\"payload_bits\": %llu, \"bits_per_symbol\": %.6f, "
+			"\"entropy\": %.6f, \"stuffed_bytes\": %llu, ",
+			(unsigned long long)stats->payload_bits, bits_per_symbol(stats),
+			stats->entropy, (unsigned long long)stats->stuffed_bytes);
+	fprintf(out, "\"num_codes\": %u, \"min_bits\": %u, \"max_bits\": %u, "
+			"\"dec_table_size\": %lu, \"limit_adjust\": %lu, ",
+			(unsigned)stats->num_codes, (unsigned)stats->min_bits,
+			(unsigned)stats->max_bits, (unsigned long)stats->dec_table_size,
+			(unsigned long)stats->limit_adjust);
+	fprintf(out, "\"num_flush\": %llu, \"latency_ns\": %llu, "
+			"\"max_latency_ns\": %llu}\n",
+			(unsigned long long)stats->num_flush,
+			(unsigned long long)stats->latency_ns,
+			(unsigned long long)stats->max_latency_ns);
+}
+
@@ -0,0 +1,75 @@
+/*
+ * @file huff_stats.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Statistics and timing of the encoding and decoding stages.
+ */
+
+#ifndef HUFF_STATS_H
+#define HUFF_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+enum huff_stage {
+	HUFF_STAGE_GEN_ENC,
+	HUFF_STAGE_ENCODE,
+	HUFF_STAGE_GEN_DEC,
+	HUFF_STAGE_DECODE,
+	HUFF_STAGE_FLUSH,
+	HUFF_NUM_STAGES
+};
+
+/* Filled by huff_gen_enc, huff_encode, huff_gen_dec and the decode functions
+ * when the stats pointer of the encoder or decoder is set. The library
+ * counts the symbol data only: in_bytes on encoding and out_bytes on
+ * decoding. The compressed size including headers is set by the caller. */
+struct huff_stats {
+	uint64_t time_ns[HUFF_NUM_STAGES];
+	uint64_t cycles[HUFF_NUM_STAGES];
+
+	uint64_t num_sym;
+	uint64_t in_bytes;
+	uint64_t out_bytes;
+	uint64_t payload_bits;  /* coded bits without stuffing and padding */
+	uint64_t stuffed_bytes; /* zero bytes inserted after 0xFF */
+	double   entropy;       /* order-0 entropy in bits per symbol */
+	double   entropy_sym;   /* symbols the entropy is averaged over */
+
+	/* over all tables: the most codes and the shortest and longest code */
+	uint32_t num_codes;
+	uint8_t  min_bits;
+	uint8_t  max_bits;
+	uint32_t dec_table_size; /* in bytes */
+	uint32_t limit_adjust;   /* code lengths changed by limit_length */
+
+	/* streams: latency is the encode and flush time of a message */
+	uint64_t num_flush;
+	uint64_t latency_ns;
+	uint64_t max_latency_ns;
+};
+
+struct huff_timer {
+	uint64_t ns;
+	uint64_t cycles;
+};
+
+void huff_timer_start(struct huff_timer *timer, const struct huff_stats *stats);
+void huff_timer_stop(const struct huff_timer *timer, struct huff_stats *stats,
+					 enum huff_stage stage);
+uint64_t huff_timer_ns(const struct huff_timer *timer);
+
+/* merges the codes of another table, min_bits 0 if unknown */
+void huff_stats_table(struct huff_stats *stats, uint32_t num_codes,
+					  uint8_t min_bits, uint8_t max_bits);
+/* averages the entropy of another table over num_sym symbols */
+void huff_stats_entropy(struct huff_stats *stats, double entropy,
+						double num_sym);
+/* adds the stats of another thread or file */
+void huff_stats_merge(struct huff_stats * restrict dst,
+					  const struct huff_stats * restrict src);
+void huff_stats_print(FILE *out, const struct huff_stats *stats);
+void huff_stats_print_json(FILE *out, const struct huff_stats *stats);
+
+#endif
+
@@ -0,0 +1,109 @@
+/*
+ * @file huff_stream.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ */
+
+#include <assert.h>
+#include "huff_format.h"
+#include "huff_stream.h"
+
+bool huff_stream_init(struct huff_stream * restrict stream,
+					  const struct huff_enc * restrict encoder,
+					  const struct huff_enc_info * restrict info, FILE *out)
+{
+	assert(stream  != NULL);
+	assert(encoder != NULL);
+	assert(info    != NULL);
+	assert(out     != NULL);
+
+	const uint8_t header[4] = { 0xFF, JPG_STR, 0, 2 };
+	if (fwrite(header, sizeof(header), 1, out) != 1) {
+		fprintf(stderr, "Couldn't write header\n");
+		return false;
+	}
+
+	if (!huff_enc_write_dht(out, encoder, info))
+		return false;
+
+	stream->encoder = encoder;
+	stream->num_sym = 0;
+	stream->pending_ns = 0;
+	stream->writer = bit_writer_create(out);
+	if (stream->writer == NULL) {
+		perror("Couldn't create bit writer");
+		return false;
+	}
+
+	return true;
+}
+
+bool huff_stream_write(struct huff_stream * restrict stream,
+					   const uint8_t data[restrict], size_t size)
+{
+	assert(stream != NULL);
+	assert(data   != NULL || size == 0);
+
+	struct huff_timer timer;
+	huff_timer_start(&timer, stream->encoder->stats);
+
+	if (!huff_encode(stream->encoder, size, data, stream->writer))
+		return false;
+
+	stream->num_sym += size;
+	if (stream->encoder->stats != NULL)
+		stream->pending_ns += huff_timer_ns(&timer);
+
+	return true;
+}
+
+bool huff_stream_flush(struct huff_stream *stream)
+{
+	assert(stream != NULL);
+
+	if (stream->num_sym == 0)
+		return bit_writer_sync(stream->writer);
+
+	struct huff_timer timer;
+	huff_timer_start(&timer, stream->encoder->stats);
+
+	uint8_t segment[12] = { 0xFF, JPG_FLS, 0, 10 };
+	for (int i = 0; i < 8; i++)
+		segment[4 + i] = (stream->num_sym >> (56 - 8 * i)) & 0xFF;
+
+	if (!bit_writer_align(stream->writer) ||
+		!bit_writer_write_raw(stream->writer, segment, sizeof(segment)) ||
+		!bit_writer_sync(stream->writer)) {
+		fprintf(stderr, "Couldn't flush stream\n");
+		return false;
+	}
+
+	struct huff_stats *stats = stream->encoder->stats;
+	if (stats != NULL) {
+		uint64_t latency = stream->pending_ns + huff_timer_ns(&timer);
+
+		huff_timer_stop(&timer, stats, HUFF_STAGE_FLUSH);
+		stats->num_flush++;
+		stats->latency_ns += latency;
+		if (latency > stats->max_latency_ns)
+			stats->max_latency_ns = latency;
+	}
+
+	stream->num_sym = 0;
+	stream->pending_ns = 0;
+	return true;
+}
+
+bool huff_stream_close(struct huff_stream *stream)
+{
+	assert(stream != NULL);
+
+	const uint8_t eoi[2] = { 0xFF, JPG_EOI };
+	bool ok = huff_stream_flush(stream) &&
+		bit_writer_write_raw(stream->writer, eoi, sizeof(eoi)) &&
+		bit_writer_sync(stream->writer);
+
+	bit_writer_destroy(stream->writer);
+	stream->writer = NULL;
+	return ok;
+}
@@ -0,0 +1,39 @@
+/*
+ * @file huff_stream.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Streams that can be decoded up to every flush point.
+ */
+
+#ifndef HUFF_STREAM_H
+#define HUFF_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "bit_writer.h"
+#include "huff_enc.h"
+
+/* A stream is an STR segment and the DHT segment, followed by any number
+ * of flushed parts and the EOI marker. Every part is entropy data padded
+ * to a byte boundary and an FLS segment with its number of symbols, so the
+ * receiver can decode a part as soon as the FLS segment arrived. The table
+ * is used for all parts. */
+struct huff_stream {
+	const struct huff_enc *encoder;
+	struct bit_writer *writer;
+
+	uint64_t num_sym;    /* symbols since the last flush */
+	uint64_t pending_ns; /* encode time since the last flush */
+};
+
+bool huff_stream_init(struct huff_stream * restrict stream,
+					  const struct huff_enc * restrict encoder,
+					  const struct huff_enc_info * restrict info, FILE *out);
+bool huff_stream_write(struct huff_stream * restrict stream,
+					   const uint8_t data[restrict], size_t size);
+bool huff_stream_flush(struct huff_stream *stream);
+/* flushes and ends the stream, the stream can't be used afterwards */
+bool huff_stream_close(struct huff_stream *stream);
+
+#endif
@@ -0,0 +1,300 @@
+/*
+ * @file huff_table.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+#include "huff_format.h"
+#include "huff_table.h"
+
+static const struct huff_table *registry[256];
+
+bool huff_table_train(const uint64_t freq[restrict 256], uint8_t id,
+					  struct huff_table * restrict table)
+{
+	assert(freq  != NULL);
+	assert(table != NULL);
+
+	if (id == 0) {
+		fprintf(stderr, "Table id 0 is reserved\n");
+		return false;
+	}
+
+	/* every symbol gets a code so that any input can be encoded */
+	uint64_t smoothed[256];
+	for (int i = 0; i < 256; i++)
+		smoothed[i] = (freq[i] < UINT64_MAX) ? freq[i] + 1 : freq[i];
+
+	struct huff_enc enc = { 0 };
+	struct huff_enc_info info;
+	if (!huff_gen_enc(smoothed, &enc, &info))
+		return false;
+
+	table->id = id;
+	table->num_codes = huff_enc_export(&enc, table->codes_per_len,
+									   table->symbols);
+
+	huff_enc_destroy(&enc);
+	return huff_table_build(table);
+}
+
+bool huff_table_build(struct huff_table *table)
+{
+	assert(table != NULL);
+
+	table->enc_lookup  = NULL;
+	table->dec_entries = NULL;
+
+	uint16_t num_codes = 0;
+	uint8_t min_bits = 0;
+	uint8_t max_bits = 0;
+
+	for (int i = 0; i < 16; i++) {
+		if (table->codes_per_len[i] == 0)
+			continue;
+
+		num_codes += table->codes_per_len[i];
+		max_bits = i + 1;
+		min_bits = (min_bits == 0) ? i + 1 : min_bits;
+	}
+
+	if (num_codes == 0 || num_codes > 256 || num_codes != table->num_codes) {
+		fprintf(stderr, "Invalid number of symbols\n");
+		return false;
+	}
+
+	table->min_bits = min_bits;
+	table->max_bits = max_bits;
+
+	uint32_t *lookup = calloc(256, sizeof(*lookup));
+	if (lookup == NULL) {
+		perror("Couldn't allocate encode table");
+		return false;
+	}
+
+	/* canonical codes, same order as gen_canonical_codes and huff_gen_dec */
+	uint16_t code = 0;
+	uint16_t sym_index = 0;
+	for (int i = 0; i < 16; i++) {
+		for (int j = 0; j < table->codes_per_len[i]; j++) {
+			lookup[table->symbols[sym_index]] = (code << 8) | (i + 1);
+			sym_index++;
+			code++;
+		}
+
+		code <<= 1;
+	}
+
+	struct huff_dec dec = { 0 };
+	if (!huff_gen_dec(table->codes_per_len, table->symbols, &dec)) {
+		free(lookup);
+		return false;
+	}
+
+	table->enc_lookup  = lookup;
+	table->dec_entries = dec.entries;
+	return true;
+}
+
+void huff_table_destroy(struct huff_table *table)
+{
+	assert(table != NULL);
+
+	free((void *)table->enc_lookup);
+	free((void *)table->dec_entries);
+	table->enc_lookup  = NULL;
+	table->dec_entries = NULL;
+}
+
+bool huff_table_read(FILE *in, struct huff_table *table)
+{
+	assert(in    != NULL);
+	assert(table != NULL);
+
+	uint8_t header[21];
+	if (fread(header, sizeof(header), 1, in) != 1) {
+		fprintf(stderr, "Couldn't read table header\n");
+		return false;
+	}
+
+	if (header[0] != 0xFF || header[1] != JPG_DHT) {
+		fprintf(stderr, "Invalid table header\n");
+		return false;
+	}
+
+	if (header[4] == 0) {
+		fprintf(stderr, "Invalid table id\n");
+		return false;
+	}
+
+	uint16_t header_length = (header[2] << 8) | header[3];
+	uint16_t num_codes = 0;
+	for (int i = 0; i < 16; i++) {
+		table->codes_per_len[i] = header[5 + i];
+		num_codes += header[5 + i];
+	}
+
+	if (num_codes == 0 || num_codes > 256 || header_length != 19 + num_codes) {
+		fprintf(stderr, "Invalid table header length\n");
+		return false;
+	}
+
+	if (fread(table->symbols, num_codes, 1, in) != 1) {
+		fprintf(stderr, "Couldn't read symbol table\n");
+		return false;
+	}
+
+	table->id = header[4];
+	table->num_codes = num_codes;
+	return huff_table_build(table);
+}
+
+bool huff_table_write(FILE *out, const struct huff_table *table)
+{
+	assert(out   != NULL);
+	assert(table != NULL);
+
+	uint8_t header[21];
+	header[0] = 0xFF;
+	header[1] = JPG_DHT;
+
+	uint16_t header_length = 19 + table->num_codes;
+	header[2] = header_length >> 8;
+	header[3] = header_length & 0xFF;
+
+	/* destination index is the table id */
+	header[4] = table->id;
+
+	for (int i = 0; i < 16; i++)
+		header[5 + i] = table->codes_per_len[i];
+
+	if (fwrite(header, sizeof(header), 1, out) != 1 ||
+		fwrite(table->symbols, table->num_codes, 1, out) != 1) {
+		fprintf(stderr, "Couldn't write table\n");
+		return false;
+	}
+
+	return true;
+}
+
+bool huff_table_write_c(FILE *out, const char *name,
+						const struct huff_table *table)
+{
+	assert(out   != NULL);
+	assert(name  != NULL);
+	assert(table != NULL);
+	assert(table->enc_lookup  != NULL);
+	assert(table->dec_entries != NULL);
+
+	fprintf(out, "/* Generated by huffenc --train. Do not edit. */\n\n#ifndef ");
+	for (const char *c = name; *c != '\0'; c++)
+		fputc(toupper((unsigned char)*c), out);
+	fprintf(out, "_H\n#define ");
+	for (const char *c = name; *c != '\0'; c++)
+		fputc(toupper((unsigned char)*c), out);
+	fprintf(out, "_H\n\n#include \"huff_table.h\"\n\n");
+
+	fprintf(out, "static const uint32_t %s_enc_lookup[256] = {", name);
+	for (int i = 0; i < 256; i++) {
+		fprintf(out, "%s0x%06X,", (i % 8 == 0) ? "\n\t" : " ",
+				(unsigned)table->enc_lookup[i]);
+	}
+	fprintf(out, "\n};\n\n");
+
+	/* includes the zero entry after the table */
+	uint32_t num_entries = (1 << table->max_bits) + 1;
+	fprintf(out, "static const uint16_t %s_dec_entries[%u] = {", name,
+			(unsigned)num_entries);
+	for (uint32_t i = 0; i < num_entries; i++) {
+		fprintf(out, "%s0x%04X,", (i % 8 == 0) ? "\n\t" : " ",
+				(unsigned)table->dec_entries[i]);
+	}
+	fprintf(out, "\n};\n\n");
+
+	fprintf(out, "static const struct huff_table %s = {\n", name);
+	fprintf(out, "\t.id = %u,\n", (unsigned)table->id);
+	fprintf(out, "\t.min_bits = %u,\n", (unsigned)table->min_bits);
+	fprintf(out, "\t.max_bits = %u,\n", (unsigned)table->max_bits);
+	fprintf(out, "\t.num_codes = %u,\n", (unsigned)table->num_codes);
+
+	fprintf(out, "\t.codes_per_len = {");
+	for (int i = 0; i < 16; i++)
+		fprintf(out, "%s%u", (i == 0) ? " " : ", ",
+				(unsigned)table->codes_per_len[i]);
+	fprintf(out, " },\n");
+
+	fprintf(out, "\t.symbols = {");
+	for (int i = 0; i < table->num_codes; i++) {
+		fprintf(out, "%s0x%02X", (i % 12 == 0) ? "\n\t\t" : " ",
+				(unsigned)table->symbols[i]);
+		if (i != table->num_codes - 1)
+			fputc(',', out);
+	}
+	fprintf(out, "\n\t},\n");
+
+	fprintf(out, "\t.enc_lookup = %s_enc_lookup,\n", name);
+	fprintf(out, "\t.dec_entries = %s_dec_entries\n", name);
+	fprintf(out, "};\n\n#endif\n");
+
+	if (ferror(out)) {
+		fprintf(stderr, "Couldn't write C header\n");
+		return false;
+	}
+
+	return true;
+}
+
+bool huff_table_register(const struct huff_table *table)
+{
+	assert(table != NULL);
+
+	if (table->id == 0) {
+		fprintf(stderr, "Table id 0 is reserved\n");
+		return false;
+	}
+
+	if (registry[table->id] != NULL && registry[table->id] != table) {
+		fprintf(stderr, "Table id %u is already registered\n",
+				(unsigned)table->id);
+		return false;
+	}
+
+	registry[table->id] = table;
+	return true;
+}
+
+const struct huff_table *huff_table_find(uint8_t id)
+{
+	return registry[id];
+}
+
+void huff_enc_from_table(const struct huff_table * restrict table,
+						 struct huff_enc * restrict encoder)
+{
+	assert(table   != NULL);
+	assert(encoder != NULL);
+
+	encoder->codes = NULL;
+	encoder->num_codes = table->num_codes;
+	memcpy(encoder->lookup, table->enc_lookup, sizeof(encoder->lookup));
+
+	if (encoder->stats != NULL) {
+		huff_stats_table(encoder->stats, table->num_codes, table->min_bits,
+						 table->max_bits);
+	}
+}
+
+void huff_dec_from_table(const struct huff_table * restrict table,
+						 struct huff_dec * restrict decoder)
+{
+	assert(table   != NULL);
+	assert(decoder != NULL);
+
+	huff_dec_set_table(decoder, table->min_bits, table->max_bits,
+					   table->dec_entries);
+}
+
@@ -0,0 +1,50 @@
+/*
+ * @file huff_table.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Predefined tables with prebuilt encode and decode tables.
+ */
+
+#ifndef HUFF_TABLE_H
+#define HUFF_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "huff_enc.h"
+#include "huff_dec.h"
+
+/* Table ids 1 to 255 can be referenced by a frame. Id 0 is reserved for
+ * frames with their own DHT header. */
+struct huff_table {
+	uint8_t  id;
+	uint8_t  min_bits;
+	uint8_t  max_bits;
+	uint16_t num_codes;
+	uint8_t  codes_per_len[16];
+	uint8_t  symbols[256]; /* ordered by code length */
+
+	const uint32_t *enc_lookup;  /* same layout as huff_enc.lookup */
+	const uint16_t *dec_entries; /* same layout as huff_dec.entries */
+};
+
+bool huff_table_train(const uint64_t freq[restrict 256], uint8_t id,
+					  struct huff_table * restrict table);
+bool huff_table_build(struct huff_table *table);
+void huff_table_destroy(struct huff_table *table);
+
+bool huff_table_read(FILE *in, struct huff_table *table);
+bool huff_table_write(FILE *out, const struct huff_table *table);
+bool huff_table_write_c(FILE *out, const char *name,
+						const struct huff_table *table);
+
+bool huff_table_register(const struct huff_table *table);
+const struct huff_table *huff_table_find(uint8_t id);
+
+void huff_enc_from_table(const struct huff_table * restrict table,
+						 struct huff_enc * restrict encoder);
+void huff_dec_from_table(const struct huff_table * restrict table,
+						 struct huff_dec * restrict decoder);
+
+#endif
+
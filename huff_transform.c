@@ -0,0 +1,421 @@
+/*
+ * @file huff_transform.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "huff_enc.h"
+#include "huff_estimate.h"
+#include "huff_crc.h"
+#include "huff_transform.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef __SSE2__
+#define HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#define UNTRANSFORM_BUF_SIZE (64 * 1024)
+
+/* RLE: a run of more than RLE_MAX_RUN bytes starts a new run */
+#define RLE_MAX_RUN (2 + 255)
+
+/* huff_transform_select estimates every transform on up to 64 KiB */
+#define SELECT_SAMPLE (64 * 1024)
+#define SELECT_SLICES (16)
+
+/* XFM segment in front of the DHT */
+#define XFM_BYTES (5)
+
+static void delta_scalar(const uint8_t in[restrict], size_t start, size_t size,
+						 uint8_t out[restrict])
+{
+	for (size_t i = start; i < size; i++)
+		out[i] = in[i] - ((i > 0) ? in[i - 1] : 0);
+}
+
+#ifdef HAVE_AVX2
+__attribute__((target("avx2")))
+static void delta_avx2(const uint8_t in[restrict], size_t size,
+					   uint8_t out[restrict])
+{
+	size_t i = 1;
+	for (; i + 32 <= size; i += 32) {
+		__m256i cur = _mm256_loadu_si256((const __m256i *)&in[i]);
+		__m256i prev = _mm256_loadu_si256((const __m256i *)&in[i - 1]);
+		_mm256_storeu_si256((__m256i *)&out[i], _mm256_sub_epi8(cur, prev));
+	}
+
+	delta_scalar(in, 0, 1, out);
+	delta_scalar(in, i, size, out);
+}
+#endif
+
+static size_t delta(const uint8_t in[restrict], size_t size,
+					uint8_t out[restrict])
+{
+#ifdef HAVE_AVX2
+	if (size > 0 && __builtin_cpu_supports("avx2")) {
+		delta_avx2(in, size, out);
+		return size;
+	}
+#endif
+
+	delta_scalar(in, 0, size, out);
+	return size;
+}
+
+/* prefix sum in place, returns the last byte */
+static uint8_t undelta(uint8_t data[], size_t size, uint8_t prev)
+{
+	size_t i = 0;
+
+#ifdef HAVE_SSE2
+	__m128i carry = _mm_set1_epi8((char)prev);
+
+	for (; i + 16 <= size; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)&data[i]);
+		x = _mm_add_epi8(x, _mm_slli_si128(x, 1));
+		x = _mm_add_epi8(x, _mm_slli_si128(x, 2));
+		x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+		x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+		x = _mm_add_epi8(x, carry);
+		_mm_storeu_si128((__m128i *)&data[i], x);
+
+		/* broadcast of the last byte */
+		carry = _mm_srli_si128(x, 15);
+		carry = _mm_unpacklo_epi8(carry, carry);
+		carry = _mm_shufflelo_epi16(carry, 0);
+		carry = _mm_shuffle_epi32(carry, 0);
+	}
+
+	if (i > 0)
+		prev = data[i - 1];
+#endif
+
+	for (; i < size; i++)
+		prev = data[i] = data[i] + prev;
+
+	return prev;
+}
+
+static int mtf_find(const uint8_t order[256], uint8_t sym)
+{
+	if (order[0] == sym)
+		return 0;
+
+#ifdef HAVE_SSE2
+	__m128i key = _mm_set1_epi8((char)sym);
+
+	for (int i = 0; i < 256; i += 16) {
+		__m128i x = _mm_loadu_si128((const __m128i *)&order[i]);
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(x, key));
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+
+	assert(false);
+	return 0;
+#else
+	int i = 1;
+	while (order[i] != sym)
+		i++;
+
+	return i;
+#endif
+}
+
+static void mtf_init(uint8_t order[256])
+{
+	for (int i = 0; i < 256; i++)
+		order[i] = i;
+}
+
+static size_t mtf(const uint8_t in[restrict], size_t size,
+				  uint8_t out[restrict])
+{
+	uint8_t order[256];
+	mtf_init(order);
+
+	for (size_t i = 0; i < size; i++) {
+		uint8_t sym = in[i];
+		int index = mtf_find(order, sym);
+
+		memmove(&order[1], &order[0], index);
+		order[0] = sym;
+		out[i] = index;
+	}
+
+	return size;
+}
+
+static void unmtf(uint8_t data[], size_t size, uint8_t order[256])
+{
+	for (size_t i = 0; i < size; i++) {
+		uint8_t index = data[i];
+		uint8_t sym = order[index];
+
+		memmove(&order[1], &order[0], index);
+		order[0] = sym;
+		data[i] = sym;
+	}
+}
+
+static size_t rle(const uint8_t in[restrict], size_t size,
+				  uint8_t out[restrict])
+{
+	size_t pos = 0;
+
+	for (size_t i = 0; i < size;) {
+		uint8_t sym = in[i];
+		size_t run = 1;
+		while (i + run < size && in[i + run] == sym && run < RLE_MAX_RUN)
+			run++;
+
+		out[pos++] = sym;
+		if (run >= 2) {
+			out[pos++] = sym;
+			out[pos++] = run - 2;
+		}
+
+		i += run;
+	}
+
+	return pos;
+}
+
+/* returns the size of the output, at most huff_untransform_bound(size) */
+static size_t unrle(struct huff_untransform * restrict state,
+					const uint8_t data[restrict], size_t size,
+					uint8_t out[restrict])
+{
+	size_t pos = 0;
+
+	for (size_t i = 0; i < size; i++) {
+		if (state->num_equal == 2) {
+			memset(&out[pos], state->prev, data[i]);
+			pos += data[i];
+			state->num_equal = 0;
+			continue;
+		}
+
+		out[pos++] = data[i];
+		if (state->num_equal == 1 && data[i] == state->prev)
+			state->num_equal = 2;
+		else
+			state->num_equal = 1;
+		state->prev = data[i];
+	}
+
+	return pos;
+}
+
+/* writes the output and updates crc */
+static bool output(const uint8_t data[], size_t size, uint32_t *crc, FILE *out)
+{
+	if (crc != NULL)
+		*crc = huff_crc32c(*crc, data, size);
+
+	return out == NULL || fwrite(data, 1, size, out) == size;
+}
+
+static bool unrle_write(struct huff_untransform * restrict state,
+						const uint8_t data[restrict], size_t size,
+						uint32_t *crc, FILE *out)
+{
+	uint8_t buffer[UNTRANSFORM_BUF_SIZE];
+	size_t step = (sizeof(buffer) - 255) / 86;
+
+	for (size_t i = 0; i < size; i += step) {
+		size_t len = (size - i < step) ? size - i : step;
+		size_t pos = unrle(state, &data[i], len, buffer);
+
+		if (!output(buffer, pos, crc, out))
+			return false;
+	}
+
+	return true;
+}
+
+size_t huff_transform_bound(size_t size)
+{
+	/* RLE: two equal bytes take three bytes */
+	return size + size / 2 + 1;
+}
+
+size_t huff_transform(enum huff_transform type, const uint8_t in[restrict],
+					  size_t size, uint8_t out[restrict])
+{
+	assert(in  != NULL || size == 0);
+	assert(out != NULL);
+
+	switch (type) {
+	case HUFF_TRANSFORM_DELTA:
+		return delta(in, size, out);
+	case HUFF_TRANSFORM_MTF:
+		return mtf(in, size, out);
+	case HUFF_TRANSFORM_RLE:
+		return rle(in, size, out);
+	default:
+		memcpy(out, in, size);
+		return size;
+	}
+}
+
+/* estimated size of a block with this data */
+static uint64_t cost(const uint8_t data[], size_t size)
+{
+	uint64_t freq[256];
+	huff_get_freq(data, size, freq);
+
+	struct huff_enc enc = { 0 };
+	struct huff_enc_info info;
+	struct huff_estimate estimate;
+
+	if (size == 0 || !huff_gen_enc(freq, &enc, &info))
+		return UINT64_MAX;
+
+	uint64_t bytes = UINT64_MAX;
+	if (huff_estimate_enc(freq, &enc, &estimate))
+		bytes = estimate.total_bytes;
+
+	huff_enc_destroy(&enc);
+	return bytes;
+}
+
+/* Large inputs are estimated on SELECT_SLICES evenly spaced slices, the
+ * seams between the slices hardly change the estimate. */
+static size_t sample(const uint8_t in[restrict], size_t size,
+					 uint8_t out[restrict])
+{
+	if (size <= SELECT_SAMPLE) {
+		memcpy(out, in, size);
+		return size;
+	}
+
+	size_t slice = SELECT_SAMPLE / SELECT_SLICES;
+	for (size_t i = 0; i < SELECT_SLICES; i++) {
+		size_t start = i * (size - slice) / (SELECT_SLICES - 1);
+		memcpy(&out[i * slice], &in[start], slice);
+	}
+
+	return SELECT_SAMPLE;
+}
+
+enum huff_transform huff_transform_select(const uint8_t in[restrict],
+										  size_t size, uint8_t out[restrict],
+										  size_t * restrict out_size)
+{
+	assert(in       != NULL);
+	assert(out      != NULL);
+	assert(out_size != NULL);
+
+	size_t bound = huff_transform_bound(SELECT_SAMPLE);
+	uint8_t *samples = malloc(SELECT_SAMPLE + bound);
+	if (samples == NULL)
+		return HUFF_TRANSFORM_NONE;
+
+	uint8_t *candidate = samples + SELECT_SAMPLE;
+	size_t sample_size = sample(in, size, samples);
+
+	enum huff_transform best = HUFF_TRANSFORM_NONE;
+	uint64_t best_cost = cost(samples, sample_size);
+
+	for (int type = HUFF_TRANSFORM_DELTA; type < HUFF_NUM_TRANSFORMS; type++) {
+		size_t len = huff_transform(type, samples, sample_size, candidate);
+		uint64_t bytes = cost(candidate, len);
+
+		if (bytes < UINT64_MAX && bytes + XFM_BYTES < best_cost) {
+			best = type;
+			best_cost = bytes + XFM_BYTES;
+		}
+	}
+
+	free(samples);
+
+	if (best != HUFF_TRANSFORM_NONE)
+		*out_size = huff_transform(best, in, size, out);
+
+	return best;
+}
+
+void huff_untransform_init(struct huff_untransform *state,
+						   enum huff_transform type)
+{
+	assert(state != NULL);
+
+	state->type = type;
+	state->prev = 0;
+	state->num_equal = 0;
+	mtf_init(state->order);
+}
+
+size_t huff_untransform_bound(size_t size)
+{
+	/* RLE: a count after every two bytes, the first byte may be the count
+	 * of the previous chunk */
+	return 86 * size + 255;
+}
+
+size_t huff_untransform(struct huff_untransform * restrict state,
+						uint8_t data[restrict], size_t size,
+						uint8_t out[restrict])
+{
+	assert(state != NULL);
+	assert(data  != NULL);
+	assert(out   != NULL);
+
+	switch (state->type) {
+	case HUFF_TRANSFORM_RLE:
+		return unrle(state, data, size, out);
+	case HUFF_TRANSFORM_DELTA:
+		state->prev = undelta(data, size, state->prev);
+		break;
+	case HUFF_TRANSFORM_MTF:
+		unmtf(data, size, state->order);
+		break;
+	default:
+		break;
+	}
+
+	memcpy(out, data, size);
+	return size;
+}
+
+bool huff_untransform_write(struct huff_untransform * restrict state,
+							uint8_t data[restrict], size_t size,
+							uint32_t *crc, FILE *out)
+{
+	assert(state != NULL);
+	assert(data  != NULL);
+
+	bool ok;
+	switch (state->type) {
+	case HUFF_TRANSFORM_RLE:
+		ok = unrle_write(state, data, size, crc, out);
+		break;
+	case HUFF_TRANSFORM_DELTA:
+		state->prev = undelta(data, size, state->prev);
+		ok = output(data, size, crc, out);
+		break;
+	case HUFF_TRANSFORM_MTF:
+		unmtf(data, size, state->order);
+		ok = output(data, size, crc, out);
+		break;
+	default:
+		ok = output(data, size, crc, out);
+		break;
+	}
+
+	if (!ok)
+		fprintf(stderr, "Error while writing output symbols\n");
+
+	return ok;
+}
@@ -0,0 +1,58 @@
+/*
+ * @file huff_transform.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Transforms of the data before huffman coding.
+ */
+
+#ifndef HUFF_TRANSFORM_H
+#define HUFF_TRANSFORM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* stored in the XFM segment of a block */
+enum huff_transform {
+	HUFF_TRANSFORM_NONE,
+	HUFF_TRANSFORM_DELTA, /* difference to the previous byte */
+	HUFF_TRANSFORM_MTF,   /* move to front: index in the recently used list */
+	HUFF_TRANSFORM_RLE,   /* two equal bytes are followed by a repeat count */
+	HUFF_NUM_TRANSFORMS
+};
+
+/* State of the inverse transform, so the decoded data can be transformed
+ * chunk by chunk. */
+struct huff_untransform {
+	enum huff_transform type;
+	uint8_t prev;      /* delta and RLE: last byte */
+	uint8_t num_equal; /* RLE: equal bytes in a row, 2 = count follows */
+	uint8_t order[256]; /* MTF */
+};
+
+size_t huff_transform_bound(size_t size);
+/* returns the size of the transformed data */
+size_t huff_transform(enum huff_transform type, const uint8_t in[restrict],
+					  size_t size, uint8_t out[restrict]);
+/* Returns the transform with the smallest estimated output on a sample of
+ * the input, out holds the transformed data unless it is
+ * HUFF_TRANSFORM_NONE. */
+enum huff_transform huff_transform_select(const uint8_t in[restrict],
+										  size_t size, uint8_t out[restrict],
+										  size_t * restrict out_size);
+
+void huff_untransform_init(struct huff_untransform *state,
+						   enum huff_transform type);
+size_t huff_untransform_bound(size_t size);
+/* data is modified, returns the size of the output */
+size_t huff_untransform(struct huff_untransform * restrict state,
+						uint8_t data[restrict], size_t size,
+						uint8_t out[restrict]);
+/* Data is modified in place. The optional crc is updated with the output,
+ * out may be NULL to only compute it. */
+bool huff_untransform_write(struct huff_untransform * restrict state,
+							uint8_t data[restrict], size_t size,
+							uint32_t *crc, FILE *out);
+
+#endif
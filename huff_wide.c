@@ -0,0 +1,586 @@
+/*
+ * @file huff_wide.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "huff_format.h"
+#include "huff_wide.h"
+
+/* depth of a huffman tree with 64 bit frequencies, fibonacci bound */
+#define MAX_TREE_DEPTH (128)
+
+/* max_bits, 3 byte per count and per symbol */
+#define MAX_WHT_BYTES (1 + 3 * HUFF_WIDE_MAX_BITS + 3 * HUFF_WIDE_SYMBOLS)
+
+struct leaf {
+	uint64_t freq;
+	uint32_t index; /* in the histogram, num_sym for the reserved code */
+};
+
+bool huff_wide_get_freq(const uint16_t data[restrict], size_t size,
+						struct huff_wide_freq * restrict freq)
+{
+	assert(data != NULL || size == 0);
+	assert(freq != NULL);
+
+	uint64_t *count = calloc(HUFF_WIDE_SYMBOLS, sizeof(*count));
+	if (count == NULL) {
+		perror("Couldn't allocate histogram");
+		return false;
+	}
+
+	for (size_t i = 0; i < size; i++)
+		count[data[i]]++;
+
+	uint32_t num_sym = 0;
+	for (uint32_t i = 0; i < HUFF_WIDE_SYMBOLS; i++)
+		num_sym += count[i] != 0;
+
+	freq->num_sym = num_sym;
+	freq->symbols = malloc(num_sym * sizeof(*freq->symbols) + 1);
+	freq->freq = malloc(num_sym * sizeof(*freq->freq) + 1);
+	if (freq->symbols == NULL || freq->freq == NULL) {
+		perror("Couldn't allocate histogram");
+		huff_wide_freq_destroy(freq);
+		free(count);
+		return false;
+	}
+
+	uint32_t pos = 0;
+	for (uint32_t i = 0; i < HUFF_WIDE_SYMBOLS; i++) {
+		if (count[i] == 0)
+			continue;
+
+		freq->symbols[pos] = i;
+		freq->freq[pos] = count[i];
+		pos++;
+	}
+
+	free(count);
+	return true;
+}
+
+void huff_wide_freq_destroy(struct huff_wide_freq *freq)
+{
+	assert(freq != NULL);
+
+	free(freq->symbols);
+	free(freq->freq);
+	freq->symbols = NULL;
+	freq->freq = NULL;
+	freq->num_sym = 0;
+}
+
+static int compare_leaves(const void *a, const void *b)
+{
+	const struct leaf *x = a;
+	const struct leaf *y = b;
+
+	if (x->freq != y->freq)
+		return (x->freq < y->freq) ? -1 : 1;
+
+	return (x->index < y->index) ? -1 : (x->index > y->index);
+}
+
+/* Huffman tree with two queues: the sorted leaves and the internal nodes,
+ * which are created in ascending order. Returns the number of leaves per
+ * depth in count. */
+static bool tree_depths(const struct leaf leaves[], uint32_t num_leaves,
+						uint32_t count[MAX_TREE_DEPTH])
+{
+	uint32_t num_nodes = 2 * num_leaves - 1;
+	uint64_t *weight = malloc(num_nodes * sizeof(*weight));
+	uint32_t *parent = malloc(num_nodes * sizeof(*parent));
+	uint8_t *depth = malloc(num_nodes);
+	if (weight == NULL || parent == NULL || depth == NULL) {
+		perror("Couldn't allocate huffman tree");
+		free(weight);
+		free(parent);
+		free(depth);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < num_leaves; i++)
+		weight[i] = leaves[i].freq;
+
+	uint32_t leaf = 0;
+	uint32_t node = num_leaves;
+
+	for (uint32_t next = num_leaves; next < num_nodes; next++) {
+		weight[next] = 0;
+
+		for (int k = 0; k < 2; k++) {
+			uint32_t pick;
+			if (leaf < num_leaves && (node >= next || weight[leaf] <= weight[node]))
+				pick = leaf++;
+			else
+				pick = node++;
+
+			parent[pick] = next;
+			weight[next] += weight[pick];
+		}
+	}
+
+	memset(count, 0, MAX_TREE_DEPTH * sizeof(count[0]));
+	depth[num_nodes - 1] = 0;
+	for (uint32_t i = num_nodes - 1; i-- > 0;) {
+		depth[i] = depth[parent[i]] + 1;
+		assert(depth[i] < MAX_TREE_DEPTH);
+
+		if (i < num_leaves)
+			count[depth[i]]++;
+	}
+
+	free(weight);
+	free(parent);
+	free(depth);
+	return true;
+}
+
+/* Moves leaves deeper than HUFF_WIDE_MAX_BITS up like the JPEG standard
+ * (figure K.3). Returns the number of adjustments. */
+static uint32_t limit_depths(uint32_t count[MAX_TREE_DEPTH])
+{
+	uint32_t adjusted = 0;
+
+	for (int i = MAX_TREE_DEPTH - 1; i > HUFF_WIDE_MAX_BITS; i--) {
+		while (count[i] > 0) {
+			int j = i - 2;
+			while (count[j] == 0)
+				j--;
+
+			count[i] -= 2;
+			count[i - 1]++;
+			count[j + 1] += 2;
+			count[j]--;
+			adjusted++;
+		}
+	}
+
+	return adjusted;
+}
+
+bool huff_wide_gen_enc(const struct huff_wide_freq * restrict freq,
+					   struct huff_wide_enc * restrict encoder)
+{
+	assert(freq    != NULL);
+	assert(encoder != NULL);
+
+	if (freq->num_sym == 0 || freq->num_sym > HUFF_WIDE_SYMBOLS) {
+		fprintf(stderr, "Invalid number of symbols\n");
+		return false;
+	}
+
+	struct huff_timer timer;
+	huff_timer_start(&timer, encoder->stats);
+
+	/* the reserved code gets the longest length */
+	uint32_t num_leaves = freq->num_sym + 1;
+	struct leaf *leaves = malloc(num_leaves * sizeof(*leaves));
+	uint8_t *code_len = malloc(freq->num_sym);
+	encoder->lookup = calloc(HUFF_WIDE_SYMBOLS, sizeof(*encoder->lookup));
+	encoder->symbols = malloc(freq->num_sym * sizeof(*encoder->symbols));
+	if (leaves == NULL || code_len == NULL || encoder->lookup == NULL ||
+		encoder->symbols == NULL) {
+		perror("Couldn't allocate encoder");
+		free(leaves);
+		free(code_len);
+		huff_wide_enc_destroy(encoder);
+		return false;
+	}
+
+	for (uint32_t i = 0; i < freq->num_sym; i++) {
+		leaves[i].freq = freq->freq[i];
+		leaves[i].index = i;
+	}
+	leaves[freq->num_sym].freq = 0;
+	leaves[freq->num_sym].index = freq->num_sym;
+	qsort(leaves, num_leaves, sizeof(*leaves), compare_leaves);
+
+	uint32_t count[MAX_TREE_DEPTH];
+	if (!tree_depths(leaves, num_leaves, count)) {
+		free(leaves);
+		free(code_len);
+		huff_wide_enc_destroy(encoder);
+		return false;
+	}
+
+	uint32_t adjusted = limit_depths(count);
+
+	/* the least frequent leaves get the longest codes */
+	uint32_t leaf = 0;
+	for (int len = HUFF_WIDE_MAX_BITS; len > 0; len--) {
+		for (uint32_t i = 0; i < count[len]; i++, leaf++) {
+			if (leaves[leaf].index < freq->num_sym)
+				code_len[leaves[leaf].index] = len;
+		}
+	}
+
+	/* canonical codes, symbols of one length in ascending order */
+	memset(encoder->codes_per_len, 0, sizeof(encoder->codes_per_len));
+	for (uint32_t i = 0; i < freq->num_sym; i++)
+		encoder->codes_per_len[code_len[i] - 1]++;
+
+	uint32_t next_code[HUFF_WIDE_MAX_BITS + 1];
+	uint32_t next_index[HUFF_WIDE_MAX_BITS + 1];
+	uint32_t code = 0;
+	uint32_t index = 0;
+
+	encoder->min_bits = 0;
+	encoder->max_bits = 0;
+
+	for (int len = 1; len <= HUFF_WIDE_MAX_BITS; len++) {
+		next_code[len] = code;
+		next_index[len] = index;
+		code = (code + count[len]) << 1;
+		index += encoder->codes_per_len[len - 1];
+
+		if (count[len] > 0) {
+			encoder->max_bits = len;
+			if (encoder->min_bits == 0)
+				encoder->min_bits = len;
+		}
+	}
+
+	for (uint32_t i = 0; i < freq->num_sym; i++) {
+		uint8_t len = code_len[i];
+		uint16_t symbol = freq->symbols[i];
+
+		encoder->lookup[symbol] = (next_code[len]++ << 8) | len;
+		encoder->symbols[next_index[len]++] = symbol;
+	}
+
+	encoder->num_codes = freq->num_sym;
+	free(leaves);
+	free(code_len);
+
+	struct huff_stats *stats = encoder->stats;
+	if (stats != NULL) {
+		huff_stats_table(stats, encoder->num_codes, encoder->min_bits,
+						 encoder->max_bits);
+		stats->limit_adjust += adjusted;
+		huff_timer_stop(&timer, stats, HUFF_STAGE_GEN_ENC);
+	}
+
+	return true;
+}
+
+void huff_wide_enc_destroy(struct huff_wide_enc *encoder)
+{
+	assert(encoder != NULL);
+
+	free(encoder->lookup);
+	free(encoder->symbols);
+	encoder->lookup = NULL;
+	encoder->symbols = NULL;
+}
+
+static size_t put_varint(uint8_t out[], uint32_t value)
+{
+	size_t len = 0;
+	while (value >= 0x80) {
+		out[len++] = (value & 0x7F) | 0x80;
+		value >>= 7;
+	}
+
+	out[len++] = value;
+	return len;
+}
+
+static bool get_varint(const uint8_t data[], size_t size, size_t *pos,
+					   uint32_t *value)
+{
+	*value = 0;
+	for (int shift = 0; shift < 21; shift += 7) {
+		if (*pos >= size)
+			return false;
+
+		uint8_t byte = data[(*pos)++];
+		*value |= (uint32_t)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+
+	return false;
+}
+
+/* Symbols of one length are in ascending order, every symbol is stored as
+ * distance to its predecessor minus one. */
+bool huff_wide_write_wht(FILE *out, const struct huff_wide_enc *encoder)
+{
+	assert(out     != NULL);
+	assert(encoder != NULL);
+
+	uint8_t *data = malloc(6 + MAX_WHT_BYTES);
+	if (data == NULL) {
+		perror("Couldn't allocate header");
+		return false;
+	}
+
+	size_t pos = 6;
+	data[pos++] = encoder->max_bits;
+	for (int i = 0; i < encoder->max_bits; i++)
+		pos += put_varint(&data[pos], encoder->codes_per_len[i]);
+
+	uint32_t index = 0;
+	for (int i = 0; i < encoder->max_bits; i++) {
+		int32_t prev = -1;
+		for (uint32_t j = 0; j < encoder->codes_per_len[i]; j++, index++) {
+			uint16_t symbol = encoder->symbols[index];
+			pos += put_varint(&data[pos], symbol - prev - 1);
+			prev = symbol;
+		}
+	}
+
+	uint32_t length = pos - 2;
+	data[0] = 0xFF;
+	data[1] = JPG_WHT;
+	for (int i = 0; i < 4; i++)
+		data[2 + i] = (length >> (24 - 8 * i)) & 0xFF;
+
+	bool ok = fwrite(data, 1, pos, out) == pos;
+	if (!ok)
+		fprintf(stderr, "Couldn't write header\n");
+
+	free(data);
+	return ok;
+}
+
+bool huff_wide_encode(const struct huff_wide_enc * restrict encoder,
+					  size_t num_sym, const uint16_t in_data[restrict],
+					  struct bit_writer * restrict writer)
+{
+	assert(encoder != NULL);
+	assert(in_data != NULL || num_sym == 0);
+	assert(writer  != NULL);
+
+	struct huff_timer timer;
+	huff_timer_start(&timer, encoder->stats);
+
+	uint64_t stuffed = writer->num_stuffed;
+	uint64_t payload_bits = 0;
+
+	const uint32_t *lookup = encoder->lookup;
+	for (size_t i = 0; i < num_sym; i++) {
+		uint32_t entry = lookup[in_data[i]];
+		uint32_t code = entry >> 8;
+		uint8_t code_len = entry & 0xFF;
+
+		/* symbol has no code in this table */
+		if (code_len == 0)
+			return false;
+
+		payload_bits += code_len;
+
+		/* bit_writer_next_bits takes up to 16 bits */
+		if (code_len > 16) {
+			if (!bit_writer_next_bits(writer, code >> 16, code_len - 16) ||
+				!bit_writer_next_bits(writer, code & 0xFFFF, 16))
+				return false;
+		} else if (!bit_writer_next_bits(writer, code, code_len)) {
+			return false;
+		}
+	}
+
+	struct huff_stats *stats = encoder->stats;
+	if (stats != NULL) {
+		stats->num_sym += num_sym;
+		stats->in_bytes += 2 * num_sym;
+		stats->payload_bits += payload_bits;
+		stats->stuffed_bytes += writer->num_stuffed - stuffed;
+		huff_timer_stop(&timer, stats, HUFF_STAGE_ENCODE);
+	}
+
+	return true;
+}
+
+static bool gen_dec(const uint32_t counts[restrict],
+					struct huff_wide_dec * restrict decoder)
+{
+	uint32_t code = 0;
+	uint32_t index = 0;
+
+	for (int len = 1; len <= decoder->max_bits; len++) {
+		uint32_t num = counts[len - 1];
+		decoder->offset[len] = (int32_t)index - (int32_t)code;
+
+		if (code + num > (1u << len))
+			return false; /* more codes than possible */
+
+		for (uint32_t i = 0; i < num && len <= HUFF_WIDE_LOOKUP_BITS; i++) {
+			uint32_t first = (code + i) << (HUFF_WIDE_LOOKUP_BITS - len);
+			uint32_t entry = ((uint32_t)decoder->symbols[index + i] << 8) | len;
+
+			for (uint32_t j = 0; j < (1u << (HUFF_WIDE_LOOKUP_BITS - len)); j++)
+				decoder->entries[first + j] = entry;
+		}
+
+		code += num;
+		index += num;
+		decoder->limit[len] = code << (HUFF_WIDE_MAX_BITS - len);
+		code <<= 1;
+	}
+
+	return true;
+}
+
+bool huff_wide_read_wht(FILE *in, struct huff_wide_dec *decoder)
+{
+	assert(in      != NULL);
+	assert(decoder != NULL);
+
+	struct huff_timer timer;
+	huff_timer_start(&timer, decoder->stats);
+
+	uint8_t header[4];
+	if (fread(header, sizeof(header), 1, in) != 1) {
+		fprintf(stderr, "Couldn't read header\n");
+		return false;
+	}
+
+	uint32_t length = 0;
+	for (int i = 0; i < 4; i++)
+		length = (length << 8) | header[i];
+
+	if (length < 5 || length > 4 + MAX_WHT_BYTES) {
+		fprintf(stderr, "Invalid header length\n");
+		return false;
+	}
+
+	size_t size = length - 4;
+	uint8_t *data = malloc(size);
+	decoder->entries = calloc(1u << HUFF_WIDE_LOOKUP_BITS,
+							  sizeof(*decoder->entries));
+	decoder->symbols = malloc(HUFF_WIDE_SYMBOLS * sizeof(*decoder->symbols));
+	if (data == NULL || decoder->entries == NULL || decoder->symbols == NULL) {
+		perror("Couldn't allocate decoder");
+		free(data);
+		huff_wide_dec_destroy(decoder);
+		return false;
+	}
+
+	if (fread(data, 1, size, in) != size) {
+		fprintf(stderr, "Couldn't read header\n");
+		free(data);
+		huff_wide_dec_destroy(decoder);
+		return false;
+	}
+
+	size_t pos = 0;
+	bool ok = true;
+	uint32_t counts[HUFF_WIDE_MAX_BITS];
+	uint32_t num_codes = 0;
+
+	decoder->max_bits = data[pos++];
+	if (decoder->max_bits == 0 || decoder->max_bits > HUFF_WIDE_MAX_BITS)
+		ok = false;
+
+	for (int i = 0; ok && i < decoder->max_bits; i++) {
+		ok = get_varint(data, size, &pos, &counts[i]) &&
+			counts[i] <= HUFF_WIDE_SYMBOLS - num_codes;
+		if (ok)
+			num_codes += counts[i];
+	}
+
+	uint32_t index = 0;
+	for (int i = 0; ok && i < decoder->max_bits; i++) {
+		int32_t prev = -1;
+		for (uint32_t j = 0; ok && j < counts[i]; j++) {
+			uint32_t delta;
+			ok = get_varint(data, size, &pos, &delta) &&
+				delta < (uint32_t)(HUFF_WIDE_SYMBOLS - 1 - prev);
+			if (ok) {
+				prev += delta + 1;
+				decoder->symbols[index++] = prev;
+			}
+		}
+	}
+
+	free(data);
+
+	if (!ok || num_codes == 0 || pos != size || !gen_dec(counts, decoder)) {
+		fprintf(stderr, "Invalid wide huffman table\n");
+		huff_wide_dec_destroy(decoder);
+		return false;
+	}
+
+	struct huff_stats *stats = decoder->stats;
+	if (stats != NULL) {
+		huff_stats_table(stats, num_codes, 0, decoder->max_bits);
+		stats->dec_table_size = sizeof(uint32_t) << HUFF_WIDE_LOOKUP_BITS;
+		huff_timer_stop(&timer, stats, HUFF_STAGE_GEN_DEC);
+	}
+
+	return true;
+}
+
+void huff_wide_dec_destroy(struct huff_wide_dec *decoder)
+{
+	assert(decoder != NULL);
+
+	free(decoder->entries);
+	free(decoder->symbols);
+	decoder->entries = NULL;
+	decoder->symbols = NULL;
+}
+
+bool huff_wide_decode(const struct huff_wide_dec * restrict decoder,
+					  size_t num_sym, struct bit_reader * restrict reader,
+					  uint16_t out_buf[restrict])
+{
+	assert(decoder != NULL);
+	assert(reader  != NULL);
+	assert(out_buf != NULL || num_sym == 0);
+
+	struct huff_timer timer;
+	huff_timer_start(&timer, decoder->stats);
+
+	const uint32_t *entries = decoder->entries;
+
+	for (size_t i = 0; i < num_sym; i++) {
+		if (reader->num_bits < HUFF_WIDE_MAX_BITS)
+			bit_reader_refill(reader);
+
+		uint32_t peek = reader->bits >> (64 - HUFF_WIDE_MAX_BITS);
+		uint32_t entry = entries[peek >> (HUFF_WIDE_MAX_BITS -
+										  HUFF_WIDE_LOOKUP_BITS)];
+		uint8_t len = entry & 0xFF;
+
+		if (len != 0) {
+			out_buf[i] = entry >> 8;
+		} else {
+			/* long code, found like in the canonical decoder */
+			len = HUFF_WIDE_LOOKUP_BITS + 1;
+			while (len <= decoder->max_bits && peek >= decoder->limit[len])
+				len++;
+
+			if (len > decoder->max_bits) {
+				fprintf(stderr, "Invalid code in data\n");
+				return false;
+			}
+
+			out_buf[i] = decoder->symbols[decoder->offset[len] +
+										  (peek >> (HUFF_WIDE_MAX_BITS - len))];
+		}
+
+		bit_reader_consume(reader, len);
+	}
+
+	if (bit_reader_overrun(reader)) {
+		fprintf(stderr, "Unexpected end of input data\n");
+		return false;
+	}
+
+	struct huff_stats *stats = decoder->stats;
+	if (stats != NULL) {
+		stats->num_sym += num_sym;
+		stats->out_bytes += 2 * num_sym;
+		huff_timer_stop(&timer, stats, HUFF_STAGE_DECODE);
+	}
+
+	return true;
+}
@@ -0,0 +1,81 @@
+/*
+ * @file huff_wide.h
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Huffman coding of 16 bit symbols.
+ */
+
+#ifndef HUFF_WIDE_H
+#define HUFF_WIDE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "bit_reader.h"
+#include "bit_writer.h"
+#include "huff_stats.h"
+
+#define HUFF_WIDE_SYMBOLS     (65536)
+#define HUFF_WIDE_MAX_BITS    (24)
+#define HUFF_WIDE_LOOKUP_BITS (12)
+
+/* only the used symbols, in ascending order */
+struct huff_wide_freq {
+	uint32_t num_sym;
+	uint16_t *symbols;
+	uint64_t *freq;
+};
+
+/* The codes are canonical like in the DHT segment. The all ones code of the
+ * longest length is never used, this is specific to the WHT segment: codes
+ * of a DHT segment are complete and reserve nothing. */
+struct huff_wide_enc {
+	/* indexed by symbol: code << 8 | code_len; code_len = 0 if unused */
+	uint32_t *lookup;
+
+	uint32_t num_codes;
+	uint8_t  min_bits;
+	uint8_t  max_bits;
+	uint32_t codes_per_len[HUFF_WIDE_MAX_BITS];
+	uint16_t *symbols; /* ordered by code */
+
+	/* optional, set by the caller (NULL to disable) before huff_wide_gen_enc */
+	struct huff_stats *stats;
+};
+
+/* Codes up to HUFF_WIDE_LOOKUP_BITS are decoded with a table, longer codes
+ * canonically like struct huff_canon, left aligned to HUFF_WIDE_MAX_BITS. */
+struct huff_wide_dec {
+	uint8_t max_bits;
+
+	/* symbol << 8 | code_len; code_len = 0 for longer or invalid codes */
+	uint32_t *entries;
+	uint32_t limit[HUFF_WIDE_MAX_BITS + 1];
+	int32_t  offset[HUFF_WIDE_MAX_BITS + 1];
+	uint16_t *symbols;
+
+	/* optional, set by the caller (NULL to disable) before huff_wide_gen_dec */
+	struct huff_stats *stats;
+};
+
+bool huff_wide_get_freq(const uint16_t data[restrict], size_t size,
+						struct huff_wide_freq * restrict freq);
+void huff_wide_freq_destroy(struct huff_wide_freq *freq);
+
+bool huff_wide_gen_enc(const struct huff_wide_freq * restrict freq,
+					   struct huff_wide_enc * restrict encoder);
+void huff_wide_enc_destroy(struct huff_wide_enc *encoder);
+/* WHT segment: the code lengths and the delta coded symbols */
+bool huff_wide_write_wht(FILE *out, const struct huff_wide_enc *encoder);
+bool huff_wide_encode(const struct huff_wide_enc * restrict encoder,
+					  size_t num_sym, const uint16_t in_data[restrict],
+					  struct bit_writer * restrict writer);
+
+/* reads the WHT segment after its marker */
+bool huff_wide_read_wht(FILE *in, struct huff_wide_dec *decoder);
+void huff_wide_dec_destroy(struct huff_wide_dec *decoder);
+bool huff_wide_decode(const struct huff_wide_dec * restrict decoder,
+					  size_t num_sym, struct bit_reader * restrict reader,
+					  uint16_t out_buf[restrict]);
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * @file check_batch.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Round trips records with one shared table and decodes single
+ * records by their offset.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "../huff_batch.h"
+#include "../huff_table.h"
+
+#define NUM_RECORDS (200)
+#define MAX_RECORD (100)
+
+static int failures = 0;
+
+static void check(bool ok, const char *name, const char *what)
+{
+	if (!ok) {
+		fprintf(stderr, "FAIL %s: %s\n", name, what);
+		failures++;
+	}
+}
+
+static void check_records(const char *name, const struct huff_enc *enc,
+						  const struct huff_record records[],
+						  const uint8_t data[], size_t data_size)
+{
+	static uint8_t out[4 * NUM_RECORDS * MAX_RECORD + 2 * NUM_RECORDS];
+	static uint8_t decoded[NUM_RECORDS * MAX_RECORD];
+	size_t offsets[NUM_RECORDS + 1];
+	size_t lengths[NUM_RECORDS];
+
+	for (size_t i = 0; i < NUM_RECORDS; i++)
+		lengths[i] = records[i].len;
+
+	if (!huff_encode_batch(enc, records, NUM_RECORDS, out,
+						   huff_batch_bound(records, NUM_RECORDS), offsets)) {
+		check(false, name, "encoding");
+		return;
+	}
+
+	struct huff_dec dec = { 0 };
+	if (!huff_batch_gen_dec(enc, &dec)) {
+		check(false, name, "no decoder");
+		return;
+	}
+
+	bool ok = huff_decode_batch(&dec, out, offsets, lengths, NUM_RECORDS,
+								decoded);
+	check(ok && memcmp(decoded, data, data_size) == 0, name, "round trip");
+
+	/* every record on its own, backwards */
+	bool single = true;
+	for (size_t i = NUM_RECORDS; i-- > 0;) {
+		uint8_t record[MAX_RECORD];
+
+		if (!huff_decode_batch(&dec, out, &offsets[i], &lengths[i], 1, record) ||
+			memcmp(record, records[i].data, records[i].len) != 0)
+			single = false;
+	}
+
+	check(single, name, "random access");
+	huff_destroy(&dec);
+}
+
+int main(void)
+{
+	static uint8_t data[NUM_RECORDS * MAX_RECORD];
+	struct huff_record records[NUM_RECORDS];
+	size_t size = 0;
+	unsigned seed = 3;
+
+	/* short text like records, some empty */
+	for (size_t i = 0; i < NUM_RECORDS; i++) {
+		seed = seed * 1103515245 + 12345;
+		size_t len = (seed >> 16) % MAX_RECORD;
+
+		records[i].data = &data[size];
+		records[i].len = len;
+
+		for (size_t j = 0; j < len; j++) {
+			seed = seed * 1103515245 + 12345;
+			unsigned r = (seed >> 16) % 64;
+			data[size++] = (r < 40) ? 'a' + r % 8 : (r < 60) ? ' ' : r;
+		}
+	}
+
+	struct huff_enc enc = { 0 };
+	struct huff_enc_info info;
+	if (!huff_batch_gen_enc(records, NUM_RECORDS, &enc, &info)) {
+		fprintf(stderr, "FAIL: no table\n");
+		return EXIT_FAILURE;
+	}
+
+	check_records("own table", &enc, records, data, size);
+	huff_enc_destroy(&enc);
+
+	/* a trained table has no code list, only the lookup */
+	uint64_t freq[256] = { 0 };
+	huff_get_freq(data, size, freq);
+
+	struct huff_table table;
+	if (!huff_table_train(freq, 1, &table)) {
+		fprintf(stderr, "FAIL: no trained table\n");
+		return EXIT_FAILURE;
+	}
+
+	struct huff_enc table_enc = { 0 };
+	huff_enc_from_table(&table, &table_enc);
+	check_records("trained table", &table_enc, records, data, size);
+	huff_table_destroy(&table);
+
+	if (failures > 0)
+		return EXIT_FAILURE;
+
+	printf("check_batch: OK\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+/*
+ * @file check_counts.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Checks tables of frequencies above 32 bits and with an overflowing
+ * sum, which can't be reached with test files, and that a header with too
+ * many codes is rejected.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "../bit_reader.h"
+#include "../bit_writer.h"
+#include "../huff_enc.h"
+#include "../huff_dec.h"
+
+static int failures = 0;
+
+static void check(bool ok, const char *name, const char *what)
+{
+	if (!ok) {
+		fprintf(stderr, "FAIL %s: %s\n", name, what);
+		failures++;
+	}
+}
+
+/* the codes must be complete and every used symbol must have one */
+static bool check_lengths(const uint64_t freq[256], const struct huff_enc *enc)
+{
+	uint32_t kraft = 0;
+
+	for (int i = 0; i < 256; i++) {
+		uint8_t len = enc->lookup[i] & 0xFF;
+		if (freq[i] != 0 && (len == 0 || len > 16))
+			return false;
+		if (len != 0)
+			kraft += 1u << (16 - len);
+	}
+
+	return kraft == (1u << 16);
+}
+
+/* encodes sample with the table and decodes it again through the DHT */
+static bool round_trip(const struct huff_enc *enc,
+					   const struct huff_enc_info *info,
+					   const uint8_t sample[], size_t size)
+{
+	FILE *dht = tmpfile();
+	if (dht == NULL || !huff_enc_write_dht(dht, enc, info))
+		return false;
+
+	/* marker, length and table class, then the lengths and symbols */
+	uint8_t header[5 + 16 + 256];
+	rewind(dht);
+	size_t len = fread(header, 1, sizeof(header), dht);
+	fclose(dht);
+	if (len < 5 + 16)
+		return false;
+
+	struct huff_dec dec = { 0 };
+	if (!huff_gen_dec(&header[5], &header[5 + 16], &dec))
+		return false;
+
+	uint8_t data[1024];
+	uint8_t out[256];
+	struct bit_writer writer;
+	struct bit_reader reader;
+
+	bit_writer_init_mem(&writer, data, sizeof(data));
+	bool ok = size <= sizeof(out) && huff_encode(enc, size, sample, &writer) &&
+		bit_writer_align(&writer);
+
+	if (ok) {
+		bit_reader_init_mem(&reader, data, bit_writer_size(&writer));
+		ok = huff_decode(&dec, size, &reader, out) &&
+			memcmp(out, sample, size) == 0;
+	}
+
+	huff_destroy(&dec);
+	return ok;
+}
+
+/* expected[i] is the code length of symbol i, 0 to skip it */
+static void check_table(const char *name, const uint64_t freq[256],
+						const uint8_t expected[256],
+						const uint8_t sample[], size_t size)
+{
+	struct huff_enc enc = { 0 };
+	struct huff_enc_info info;
+
+	if (!huff_gen_enc(freq, &enc, &info)) {
+		check(false, name, "no table");
+		return;
+	}
+
+	check(check_lengths(freq, &enc), name, "invalid code lengths");
+
+	bool optimal = true;
+	for (int i = 0; i < 256; i++) {
+		if (expected[i] != 0 && (enc.lookup[i] & 0xFF) != expected[i])
+			optimal = false;
+	}
+
+	check(optimal, name, "not the optimal code lengths");
+
+	check(round_trip(&enc, &info, sample, size), name, "round trip");
+	huff_enc_destroy(&enc);
+}
+
+/* a corrupt header with more codes than fit, in both decoder modes */
+static void check_oversubscribed(void)
+{
+	static const uint8_t code_len[16] = { 2, 0, 4, 2 };
+	static const uint8_t symbols[] = "abcdefgh";
+	static const enum huff_dec_mode modes[] = {
+		HUFF_DEC_TABLE, HUFF_DEC_CANONICAL
+	};
+
+	for (int i = 0; i < 2; i++) {
+		struct huff_dec dec = { 0 };
+		dec.mode = modes[i];
+
+		bool ok = huff_gen_dec(code_len, symbols, &dec);
+		check(!ok, "oversubscribed", "table accepted");
+		if (ok)
+			huff_destroy(&dec);
+	}
+}
+
+int main(void)
+{
+	static const uint8_t sample[] = "abcdabcaabacdcbaaabbbaaccdab";
+	uint64_t freq[256];
+	uint8_t expected[256];
+
+	/* counts of a file of more than 4 GiB */
+	memset(freq, 0, sizeof(freq));
+	memset(expected, 0, sizeof(expected));
+	freq['a'] = 5000000000ULL;
+	freq['b'] = (uint64_t)UINT32_MAX + 1;
+	freq['c'] = 3000000000ULL;
+	freq['d'] = 1;
+	expected['a'] = 1;
+	expected['b'] = 2;
+	expected['c'] = 3;
+	expected['d'] = 3;
+	check_table("above 32 bits", freq, expected, sample, sizeof(sample) - 1);
+
+	/* the sum overflows, the counts are scaled */
+	uint8_t half[128];
+	for (int i = 0; i < 128; i++) {
+		freq[i] = UINT64_MAX / 3;
+		expected[i] = 7;
+		half[i] = i;
+	}
+	check_table("overflowing sum", freq, expected, half, sizeof(half));
+
+	/* scaling must keep the rare symbols */
+	memset(freq, 0, sizeof(freq));
+	memset(expected, 0, sizeof(expected));
+	freq['a'] = UINT64_MAX;
+	freq['b'] = UINT64_MAX - 5;
+	freq['c'] = 1;
+	freq['d'] = 1;
+	expected['a'] = 1;
+	expected['b'] = 2;
+	check_table("rare symbols", freq, expected, sample, sizeof(sample) - 1);
+
+	check_oversubscribed();
+
+	if (failures > 0)
+		return EXIT_FAILURE;
+
+	printf("check_counts: OK\n");
+	return EXIT_SUCCESS;
+}
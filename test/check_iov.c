@@ -0,0 +1,168 @@
+/*
+ * @file check_iov.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Encodes into tiny output segments and continues with
+ * bit_writer_set_iov, the result must equal the encoding into one buffer.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "../bit_writer.h"
+#include "../huff_enc.h"
+
+#define NUM_SYM (4096)
+#define IN_SEGMENT_SIZE (7)
+#define OUT_SEGMENTS (4)
+
+static int failures = 0;
+
+static void check(bool ok, const char *name, const char *what)
+{
+	if (!ok) {
+		fprintf(stderr, "FAIL %s: %s\n", name, what);
+		failures++;
+	}
+}
+
+/* out segments of 1 to max_len bytes */
+static void next_segments(uint8_t buffer[], size_t max_len, unsigned *seed,
+						  struct iovec iov[OUT_SEGMENTS])
+{
+	for (int i = 0; i < OUT_SEGMENTS; i++) {
+		*seed = *seed * 1103515245 + 12345;
+		iov[i].iov_base = &buffer[i * max_len];
+		iov[i].iov_len = 1 + (*seed >> 16) % max_len;
+	}
+}
+
+/* the filled bytes of the segments are appended to out */
+static void collect(const struct bit_writer *writer,
+					const struct iovec iov[OUT_SEGMENTS],
+					uint8_t out[], size_t *out_size)
+{
+	size_t left = bit_writer_iov_size(writer);
+
+	for (int i = 0; i < OUT_SEGMENTS && left > 0; i++) {
+		size_t len = (iov[i].iov_len < left) ? iov[i].iov_len : left;
+		memcpy(&out[*out_size], iov[i].iov_base, len);
+		*out_size += len;
+		left -= len;
+	}
+}
+
+static void check_segments(const char *name, const struct huff_enc *enc,
+						   const uint8_t data[], size_t max_len,
+						   const uint8_t expected[], size_t expected_size)
+{
+	static uint8_t out[4 * NUM_SYM];
+	uint8_t buffer[OUT_SEGMENTS * 3];
+	struct iovec out_iov[OUT_SEGMENTS];
+	struct iovec in_iov[NUM_SYM / IN_SEGMENT_SIZE + 1];
+	struct bit_writer writer;
+	unsigned seed = 1;
+	size_t out_size = 0;
+
+	int in_cnt = 0;
+	for (size_t pos = 0; pos < NUM_SYM; pos += IN_SEGMENT_SIZE) {
+		in_iov[in_cnt].iov_base = (uint8_t *)&data[pos];
+		in_iov[in_cnt].iov_len = (NUM_SYM - pos < IN_SEGMENT_SIZE) ?
+			NUM_SYM - pos : IN_SEGMENT_SIZE;
+		in_cnt++;
+	}
+
+	next_segments(buffer, max_len, &seed, out_iov);
+	bit_writer_init_iov(&writer, out_iov, OUT_SEGMENTS);
+
+	/* the symbols left are the segments from first on, skip bytes of it */
+	int first = 0;
+	size_t skip = 0;
+	size_t total = 0;
+	while (first < in_cnt) {
+		struct iovec in_left[NUM_SYM / IN_SEGMENT_SIZE + 1];
+		int left_cnt = in_cnt - first;
+		memcpy(in_left, &in_iov[first], left_cnt * sizeof(*in_left));
+		in_left[0].iov_base = (uint8_t *)in_left[0].iov_base + skip;
+		in_left[0].iov_len -= skip;
+
+		size_t done;
+		if (!huff_encode_iov(enc, in_left, left_cnt, &writer, &done)) {
+			check(false, name, "symbol without code");
+			return;
+		}
+
+		total += done;
+		skip += done;
+		while (first < in_cnt && skip >= in_iov[first].iov_len) {
+			skip -= in_iov[first].iov_len;
+			first++;
+		}
+
+		collect(&writer, out_iov, out, &out_size);
+		next_segments(buffer, max_len, &seed, out_iov);
+		bit_writer_set_iov(&writer, out_iov, OUT_SEGMENTS);
+	}
+
+	/* the padding can need fresh segments too */
+	while (!bit_writer_align(&writer)) {
+		collect(&writer, out_iov, out, &out_size);
+		next_segments(buffer, max_len, &seed, out_iov);
+		bit_writer_set_iov(&writer, out_iov, OUT_SEGMENTS);
+	}
+
+	collect(&writer, out_iov, out, &out_size);
+
+	check(total == NUM_SYM, name, "symbols consumed");
+	check(out_size == expected_size &&
+		  memcmp(out, expected, expected_size) == 0, name, "output differs");
+}
+
+int main(void)
+{
+	/* the rarest symbols get the all ones codes, so the output has many
+	 * 0xFF bytes that need a stuffed zero */
+	uint64_t freq[256] = { 0 };
+	for (int i = 0; i < 16; i++)
+		freq[i] = 1ull << i;
+
+	struct huff_enc enc = { 0 };
+	struct huff_enc_info info;
+	if (!huff_gen_enc(freq, &enc, &info)) {
+		fprintf(stderr, "FAIL: no table\n");
+		return EXIT_FAILURE;
+	}
+
+	static uint8_t data[NUM_SYM];
+	unsigned seed = 7;
+	for (int i = 0; i < NUM_SYM; i++) {
+		seed = seed * 1103515245 + 12345;
+		data[i] = ((seed >> 16) % 4 == 0) ? (seed >> 20) % 16 : 0;
+	}
+
+	static uint8_t expected[4 * NUM_SYM];
+	struct bit_writer writer;
+	bit_writer_init_mem(&writer, expected, sizeof(expected));
+	if (!huff_encode(&enc, NUM_SYM, data, &writer) ||
+		!bit_writer_align(&writer)) {
+		fprintf(stderr, "FAIL: encoding into one buffer\n");
+		return EXIT_FAILURE;
+	}
+
+	size_t expected_size = bit_writer_size(&writer);
+	check(writer.num_stuffed > 0, "one buffer", "no stuffed bytes");
+
+	check_segments("1 byte segments", &enc, data, 1, expected, expected_size);
+	check_segments("2 byte segments", &enc, data, 2, expected, expected_size);
+	check_segments("3 byte segments", &enc, data, 3, expected, expected_size);
+
+	huff_enc_destroy(&enc);
+
+	if (failures > 0)
+		return EXIT_FAILURE;
+
+	printf("check_iov: OK\n");
+	return EXIT_SUCCESS;
+}
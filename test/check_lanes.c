@@ -0,0 +1,160 @@
+/*
+ * @file check_lanes.c
+ * @author agent <agent@local>
+ * @date 2026-10-19
+ * @brief Compares the AVX2 lane kernels with the scalar code: both must
+ * produce the same lanes, decode them back and reject a corrupt lane size.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "../huff_lanes.h"
+
+#define MAX_SYM (16 * 1024)
+
+static int failures = 0;
+
+static void check(bool ok, const char *name, const char *what)
+{
+	if (!ok) {
+		fprintf(stderr, "FAIL %s: %s\n", name, what);
+		failures++;
+	}
+}
+
+struct lanes {
+	uint8_t out[MAX_SYM * 2 + 16 * 32];
+	size_t lane_size[HUFF_MAX_LANES];
+	size_t size;
+};
+
+static bool encode(const struct huff_enc *enc, const uint8_t data[],
+				   size_t num_sym, uint8_t num_lanes, bool scalar,
+				   struct lanes *lanes)
+{
+	huff_lanes_force_scalar(scalar);
+	bool ok = huff_encode_lanes(enc, num_sym, data, num_lanes, lanes->out,
+								sizeof(lanes->out), lanes->lane_size);
+
+	lanes->size = 0;
+	for (uint8_t i = 0; ok && i < num_lanes; i++)
+		lanes->size += lanes->lane_size[i];
+
+	return ok;
+}
+
+static bool decode(const struct huff_dec *dec, const struct lanes *lanes,
+				   const size_t lane_size[], size_t num_sym,
+				   uint8_t num_lanes, bool scalar, uint8_t out[])
+{
+	huff_lanes_force_scalar(scalar);
+	return huff_decode_lanes(dec, num_sym, lanes->out, lane_size, num_lanes,
+							 out);
+}
+
+static void check_lanes(const struct huff_enc *enc, const struct huff_dec *dec,
+						const uint8_t data[], size_t num_sym,
+						uint8_t num_lanes)
+{
+	static struct lanes vector, scalar;
+	static uint8_t out[MAX_SYM];
+	char name[64];
+	sprintf(name, "%u lanes, %lu symbols", (unsigned)num_lanes,
+			(unsigned long)num_sym);
+
+	if (!encode(enc, data, num_sym, num_lanes, false, &vector) ||
+		!encode(enc, data, num_sym, num_lanes, true, &scalar)) {
+		check(false, name, "encoding");
+		return;
+	}
+
+	check(vector.size == scalar.size &&
+		  memcmp(vector.lane_size, scalar.lane_size,
+				 num_lanes * sizeof(size_t)) == 0 &&
+		  memcmp(vector.out, scalar.out, vector.size) == 0,
+		  name, "vector and scalar lanes differ");
+
+	memset(&vector.out[vector.size], 0, HUFF_LANE_SLACK);
+	for (int s = 0; s < 2; s++) {
+		memset(out, 0, num_sym);
+		bool ok = decode(dec, &vector, vector.lane_size, num_sym, num_lanes,
+						 s == 1, out);
+		check(ok && memcmp(out, data, num_sym) == 0, name,
+			  s ? "scalar round trip" : "vector round trip");
+	}
+
+	/* the first lane ends a byte early, the second starts there: the first
+	 * lane runs out of bits */
+	if (num_lanes > 1 && vector.lane_size[0] > 0) {
+		size_t corrupt[HUFF_MAX_LANES];
+		memcpy(corrupt, vector.lane_size, sizeof(corrupt));
+		corrupt[0]--;
+		corrupt[1]++;
+
+		for (int s = 0; s < 2; s++) {
+			bool ok = decode(dec, &vector, corrupt, num_sym, num_lanes,
+							 s == 1, out);
+			check(!ok, name, s ? "scalar accepts corrupt lane size" :
+				  "vector accepts corrupt lane size");
+		}
+	}
+
+	huff_lanes_force_scalar(false);
+}
+
+int main(void)
+{
+	static uint8_t data[MAX_SYM];
+	uint64_t freq[256] = { 0 };
+	unsigned seed = 5;
+
+	/* skewed, so the lanes get codes of many lengths */
+	for (size_t i = 0; i < MAX_SYM; i++) {
+		seed = seed * 1103515245 + 12345;
+		unsigned r = (seed >> 16) & 0xFFFF;
+		data[i] = (r < 0x8000) ? r % 4 : (r < 0xF000) ? r % 32 : r >> 8;
+	}
+
+	huff_get_freq(data, MAX_SYM, freq);
+
+	struct huff_enc enc = { 0 };
+	struct huff_enc_info info;
+	if (!huff_gen_enc(freq, &enc, &info)) {
+		fprintf(stderr, "FAIL: no table\n");
+		return EXIT_FAILURE;
+	}
+
+	uint8_t codes_per_len[16];
+	uint8_t symbols[256];
+	huff_enc_export(&enc, codes_per_len, symbols);
+
+	struct huff_dec dec = { 0 };
+	if (!huff_gen_dec(codes_per_len, symbols, &dec)) {
+		fprintf(stderr, "FAIL: no decoder\n");
+		return EXIT_FAILURE;
+	}
+
+	/* whole rounds, rounds not a multiple of 4 and an incomplete round */
+	static const uint8_t lane_counts[] = { 3, 8, 16 };
+	for (int i = 0; i < 3; i++) {
+		uint8_t n = lane_counts[i];
+		const size_t sizes[] = {
+			n * 512, n * 515, n * 514 + n / 2, n * 3 + 1, MAX_SYM - 5
+		};
+
+		for (int j = 0; j < 5; j++)
+			check_lanes(&enc, &dec, data, sizes[j], n);
+	}
+
+	huff_destroy(&dec);
+	huff_enc_destroy(&enc);
+
+	if (failures > 0)
+		return EXIT_FAILURE;
+
+	printf("check_lanes: OK\n");
+	return EXIT_SUCCESS;
+}
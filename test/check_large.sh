@@ -0,0 +1,49 @@
+#!/bin/sh
+# Round trips inputs of more than 4 GiB, which need 64 bit symbol counts
+# (DNL segment) and histograms. The inputs are generated on the fly, the
+# large one is a sparse file, so only the encoded data takes disk space.
+#
+# usage: test/check_large.sh [DIR with huffenc and huffdec]
+
+set -e
+
+BIN=${1:-.}
+TMP=$(mktemp -d "${TMPDIR:-/tmp}/huff_check.XXXXXX")
+trap 'rm -rf "$TMP"' EXIT
+
+# DNL with 2^32 + 8 symbols: a table of 'a' (code 0) and 'b' (code 1)
+# followed by (2^32 + 8) / 8 zero bytes
+echo "DNL count above 32 bits"
+count=4294967304
+expected=$(head -c $count /dev/zero | tr '\000' a | cksum)
+actual=$({
+	printf '\377\304\000\025\000\002'
+	printf '\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000'
+	printf 'ab\377\334\000\012\000\000\000\001\000\000\000\010'
+	head -c $((count / 8)) /dev/zero
+} | "$BIN/huffdec" /dev/stdin | cksum)
+
+if [ "$actual" != "$expected" ]; then
+	echo "FAIL: decoded $actual, expected $expected"
+	exit 1
+fi
+
+# 4.5 GiB of zeros with text at the start, at 2 GiB and above 4 GiB, so a
+# single count is above 32 bits too
+echo "round trip of 4.5 GiB"
+truncate -s 4831838208 "$TMP/in"
+for offset in 0 2147483648 4294968530; do
+	cat "$(dirname "$0")"/*.txt | dd of="$TMP/in" bs=1 seek=$offset \
+		conv=notrunc 2>/dev/null
+done
+
+"$BIN/huffenc" "$TMP/in" "$TMP/in.huf"
+expected=$(cksum < "$TMP/in")
+actual=$("$BIN/huffdec" "$TMP/in.huf" | cksum)
+
+if [ "$actual" != "$expected" ]; then
+	echo "FAIL: decoded $actual, expected $expected"
+	exit 1
+fi
+
+echo "check_large: OK"